@@ -0,0 +1,189 @@
+#include "StageCard.h"
+
+namespace Upp {
+
+// -------------------------- Painted items --------------------------
+// Items are data records: the card keeps their rects (virtual wrap
+// geometry) in a StageRectIndex and draws them from one PaintedPane that
+// covers the whole content layer. Nothing per item is a Ctrl, so creating
+// or re-pointing 100k items costs the size cache and the index.
+StageCard& StageCard::SetPaintedItems(int count, Function<Size (int)> size_of,
+                                      Function<void (Draw&, const Rect&, int, int)> paint) {
+    One<PaintedPane> pane; // may be called from an item event
+    if(painted)
+        pane = pick(painted->pane);
+    ClearChildren(contentLayer);
+    items.Clear();
+    ClearOwned();
+    ResetLayoutCaches();
+    VirtualState& v = OwnVirtual();
+    v.pool.Clear();
+    v.bound.Clear();
+    v.ClearGeometry();
+    v.create.Clear();
+    v.bind.Clear();
+
+    PaintedState& pt = painted.Create();
+    pt.pane  = pick(pane);
+    pt.paint = pick(paint);
+    if(!pt.pane)
+        pt.pane.Create<PaintedPane>(*this);
+    contentLayer.Add(*pt.pane);
+
+    v.count = max(0, count);
+    v.size  = pick(size_of);
+    v.stack = false;
+
+    mode = ContentMode::STACK;
+    dir  = Direction::H;
+    wrap = true;
+    Relayout();
+    return *this;
+}
+
+// Leaves painted mode. The pane may be running WhenItemClick / WhenItemDrag,
+// the handler that called us, so it is only taken out of the layer here and
+// freed from the event queue.
+void StageCard::ResetPainted() {
+    if(!painted)
+        return;
+    if(PaintedPane *p = painted->pane.Detach()) {
+        p->Remove();
+        PostCallback([p] { delete p; });
+    }
+    painted.Clear();
+}
+
+// Rebuilds the index when the wrap geometry moved (width, insets, cell, a
+// shrinking count), then stretches the pane over the layer. A width change
+// reflows every line, so all rects move and the rebuild is O(count), on top
+// of the O(count) wrap pass that produced them; the index itself is one
+// counting sort. Appends at an unchanged geometry leave the earlier rects
+// where they are: only the new ones are indexed and repainted. Height-only
+// resizes and scrolling reuse the index.
+void StageCard::SyncPainted() {
+    PaintedState& pt = *painted;
+    VirtualState& v = *virt;
+    const Size cell = v.size ? Size(Null) : wrapItem.cx > 0 && wrapItem.cy > 0 ? wrapItem : Size(DPI(48), DPI(48));
+    const bool same = !pt.dirty && pt.width == v.width && pt.cols == v.cols
+                      && pt.inset == v.inset && pt.gap == v.gap && pt.cell == cell;
+    if(same && v.count > pt.count && pt.count >= 0) {
+        // Appended items: earlier rects keep their place, index only the new ones
+        Vector<Rect> r;
+        r.SetCount(v.count - pt.count);
+        Rect dirty = Null;
+        for(int i = pt.count; i < v.count; ++i) {
+            r[i - pt.count] = VirtualItemRect(i);
+            dirty = IsNull(dirty) ? r[i - pt.count] : dirty | r[i - pt.count];
+        }
+        pt.index.Append(r);
+        pt.count = v.count;
+        pt.pane->Refresh(dirty);
+    }
+    else if(!same || pt.count != v.count) {
+        Vector<Rect> r;
+        r.SetCount(v.count);
+        for(int i = 0; i < v.count; ++i)
+            r[i] = VirtualItemRect(i);
+        pt.index.Build(pick(r));
+        pt.count = v.count;
+        pt.width = v.width;
+        pt.cols  = v.cols;
+        pt.inset = v.inset;
+        pt.gap   = v.gap;
+        pt.cell  = cell;
+        pt.dirty = false;
+        if(pt.hot >= v.count)     pt.hot = -1;
+        if(pt.pressed >= v.count) pt.pressed = -1;
+        pt.pane->Refresh();
+    }
+    const Rect lr = Rect(contentLayer.GetSize());
+    if(pt.pane->GetRect() != lr)
+        pt.pane->SetRect(lr);
+}
+
+int StageCard::ItemState(int i) const {
+    if(!IsEnabled())        return ST_DISABLED;
+    if(i == painted->pressed) return ST_PRESSED;
+    if(i == painted->hot)     return ST_HOT;
+    return ST_NORMAL;
+}
+
+// Only the items under the paint rect are visited (index query, no scan)
+void StageCard::PaintItems(Draw& w) {
+    PaintedState& pt = *painted;
+    pt.index.Query(w.GetPaintRect(), pt.visible);
+    for(int i : pt.visible)
+        pt.paint(w, pt.index[i], i, ItemState(i));
+}
+
+void StageCard::PaintedMouse(int event, Point p, dword keyflags) {
+    PaintedState& pt = *painted;
+    auto SetHot = [&](int i) {
+        if(i == pt.hot) return;
+        RefreshPaintedItem(pt.hot);
+        pt.hot = i;
+        RefreshPaintedItem(i);
+    };
+    if(event == MOUSEMOVE) {
+        if(pt.pressed >= 0 && !pt.dragged && (keyflags & K_MOUSELEFT)) {
+            const Point d = p - pt.press;
+            if(max(abs(d.x), abs(d.y)) >= DPI(4)) {
+                const int i = pt.pressed;
+                pt.dragged = true;
+                pt.pressed = -1;
+                pt.pane->ReleaseCapture();
+                RefreshPaintedItem(i);
+                WhenItemDrag(i); // may run a modal drag & drop loop
+                return;
+            }
+        }
+        SetHot(pt.index.Find(p));
+    }
+    else if(event == LEFTDOWN) {
+        pt.pressed = pt.index.Find(p);
+        pt.press   = p;
+        pt.dragged = false;
+        if(pt.pressed >= 0) {
+            pt.pane->SetCapture();
+            RefreshPaintedItem(pt.pressed);
+        }
+    }
+    else if(event == LEFTUP) {
+        const int i = pt.pressed;
+        pt.pressed = -1;
+        pt.pane->ReleaseCapture();
+        RefreshPaintedItem(i);
+        const int at = pt.index.Find(p);
+        SetHot(at);
+        if(i >= 0 && !pt.dragged && at == i)
+            WhenItemClick(i); // last: the handler may replace the items
+    }
+    else if(event == MOUSELEAVE)
+        SetHot(-1);
+}
+
+void StageCard::RefreshPaintedItem(int i) {
+    if(painted && painted->pane && i >= 0 && i < painted->index.GetCount())
+        painted->pane->Refresh(painted->index[i]);
+}
+
+int StageCard::GetPaintedItemAt(Point p) const {
+    return IsPainted() ? painted->index.Find(p) : -1;
+}
+
+Rect StageCard::GetPaintedItemRect(int i) const {
+    return painted && i >= 0 && i < painted->index.GetCount() ? painted->index[i] : Rect(0, 0, 0, 0);
+}
+
+Image StageCard::GetPaintedItemImage(int i) const {
+    const Rect r = GetPaintedItemRect(i);
+    if(r.IsEmpty() || !IsPainted())
+        return Image();
+    ImageDraw iw(r.GetSize());
+    iw.DrawRect(r.GetSize(), SColorPaper());
+    painted->paint(iw, Rect(r.GetSize()), i, ST_NORMAL);
+    return iw;
+}
+
+} // namespace Upp
@@ -66,9 +66,9 @@ const StageCard::Style& StageCard::StyleDefault() {
 // -------------------------- Style setters --------------------------
 StageCard& StageCard::SetStyle(const Style& s) {
     style_ref_ = &s;
-    palette_   = s.palette;
-    metrics_   = s.metrics;
-    Layout();
+    palette_.Clear();
+    metrics_.Clear();
+    Relayout();
     Refresh();
     return *this;
 }
@@ -76,55 +76,75 @@ StageCard& StageCard::SetStyle(const Style& s) {
 StageCard& StageCard::SetStyleOwned(const Style& s) {
     owned_style_.Create() = s;
     style_ref_ = ~owned_style_;
-    palette_   = s.palette;
-    metrics_   = s.metrics;
-    Layout();
+    palette_.Clear();
+    metrics_.Clear();
+    Relayout();
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetPalette(const UiPalette& p) {
-    palette_ = p;
+    palette_.Create() = p;
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetMetrics(const UiMetrics& m) {
-    metrics_ = m;
-    Layout();
+    metrics_.Create() = m;
+    Relayout();
     return *this;
 }
 
 
 // -------------------------- Constructor --------------------------
 StageCard::StageCard() {
-    Add(headerPane);
     Add(contentPane);
     contentPane.Add(contentLayer);
-    Add(vbar);
 
-    headerPane.Transparent();
     contentPane.Transparent();
     contentLayer.Transparent();
-    vbar.Transparent();
 
-    vbar.Hide();
-    vbar.SetTotal(0);
-    vbar.SetLine(DPI(16));
-    vbar.SetPage(0);
+    lastVBarRc = RectC(0,0,0,0);
+    SetStyle(StyleDefault());
+}
+
+// -------------------------- Lazy chrome --------------------------
+StageCard::HeaderHitCtrl& StageCard::HeaderBand() {
+    if(!headerPane) {
+        Add(headerPane.Create<HeaderHitCtrl>(*this));
+        headerPane->SetRect(lastHeaderRc);
+    }
+    return *headerPane;
+}
 
-    vbar.WhenScroll = [this] {
-        scroll_y = vbar.Get();
+ScrollBar& StageCard::VBar() {
+    if(vbar)
+        return *vbar;
+    ScrollBar& sb = vbar.Create();
+    Add(sb);
+    sb.Transparent();
+    sb.Hide();
+    sb.SetTotal(0);
+    sb.SetLine(DPI(16));
+    sb.SetPage(0);
+
+    sb.WhenScroll = [this] {
+        const int d = scroll_y - vbar->Get();
+        scroll_y = vbar->Get();
+        if(!sections.IsEmpty() && d)
+            ScrollContentView(IsVerticalScroll() ? 0 : d, IsVerticalScroll() ? d : 0);
         const Rect pr = contentPane.GetRect();
         if (IsVerticalScroll())
             contentLayer.SetRect(0, -scroll_y, pr.GetWidth(), contentLayer.GetRect().GetHeight());
         else
             contentLayer.SetRect(-scroll_y, 0, contentLayer.GetRect().GetWidth(), pr.GetHeight());
-        contentLayer.Refresh();
+        SyncVirtual();
+        if(sections.IsEmpty())
+            contentLayer.Refresh();
+        SyncSections(); // moves the pinned header, O(log n); its old and new rects repaint
+        SyncCulling();
     };
-
-    lastVBarRc = RectC(0,0,0,0);
-    SetStyle(StyleDefault());
+    return sb;
 }
 
 // -------------------------- Header mouse -> state -------------------
@@ -143,6 +163,13 @@ void StageCard::OnHeaderLeftUp     (Point, dword){ if(!headerStateOn_) return; h
 
 // -------------------------- High-level layout mode ------------------
 StageCard& StageCard::SetStack(StackMode m) {
+    ApplyStack(m);
+    ResetLayoutCaches();
+    Relayout();
+    return *this;
+}
+
+void StageCard::ApplyStack(StackMode m) {
     switch(m) {
     case StackMode::NONE:
         // Manual layout, keep current scroll axis (dir)
@@ -156,35 +183,99 @@ StageCard& StageCard::SetStack(StackMode m) {
         mode = ContentMode::STACK;
         dir  = Direction::H;
         break;
+    case StackMode::GRID:
+        mode = ContentMode::GRID;
+        dir  = Direction::V;
+        break;
+    case StackMode::MASONRY:
+        mode = ContentMode::MASONRY;
+        dir  = Direction::V;
+        break;
+    }
+}
+
+StageCard::StackMode StageCard::GetStack() const {
+    switch(mode) {
+    case ContentMode::MANUAL:  return StackMode::NONE;
+    case ContentMode::GRID:    return StackMode::GRID;
+    case ContentMode::MASONRY: return StackMode::MASONRY;
+    default:                   return dir == Direction::V ? StackMode::STACKV : StackMode::STACKH;
     }
-    Layout();
-    return *this;
 }
 
 // -------------------------- stack API --------------------------
 StageCard& StageCard::ReplaceExpand(Ctrl& c, int w) {
     ClearChildren(contentLayer);
     items.Clear();
+    ClearOwned();
+    ResetLayoutCaches();
     return AddExpand(c, w);
 }
 
 StageCard& StageCard::ReplaceFixed (Ctrl& c, int px, int py) {
     ClearChildren(contentLayer);
     items.Clear();
+    ClearOwned();
+    ResetLayoutCaches();
     return AddFixed(c, px, py);
 }
 
 StageCard& StageCard::ReplaceFixed (Ctrl& c) {
     ClearChildren(contentLayer);
     items.Clear();
+    ClearOwned();
+    ResetLayoutCaches();
     return AddFixed(c);
 }
 
 StageCard& StageCard::ClearContent() {
+    if(IsVirtual())
+        return ClearVirtual();
     ClearChildren(contentLayer);
     items.Clear();
+    ClearOwned();
+    ResetLayoutCaches();
     contentDirty = true;
-    Layout();
+    Relayout();
+    return *this;
+}
+
+void StageCard::ResetLayoutCaches() {
+    for(Item& it : items)
+        it.measured = false; // natural size depends on the layout mode
+    wrapCache.Clear();
+    justifyCache.Clear(); // per-mode blocks: the next pass of that mode creates them
+    masonryCache.Clear();
+    UnpinSection();
+    sections.Clear();
+    if(cullIndex)
+        cullIndex->Clear(); // item indices may have moved; next sync re-indexes
+    ContentChanged();
+}
+
+// Items [first, n) were replaced or reordered: the incremental caches keep
+// what they laid out before `first`.
+void StageCard::ItemsChangedFrom(int first) {
+    auto Cut = [&](Vector<int>& idx) { // ascending item indices
+        int k = idx.GetCount();
+        while(k > 0 && idx[k - 1] >= first)
+            --k;
+        idx.Trim(k);
+    };
+    Cut(wrapCache.idx);
+    wrapCache.placed = min(wrapCache.placed, wrapCache.idx.GetCount());
+    if(justifyCache)
+        Cut(justifyCache->idx);
+    if(masonryCache && !masonryCache->idx.IsEmpty() && masonryCache->idx.Top() >= first)
+        masonryCache->Clear(); // column bottoms cannot be rewound
+    if(cullIndex)
+        cullIndex->Clear();
+    ContentChanged();
+}
+
+StageCard& StageCard::InvalidateContentSizes() {
+    ResetLayoutCaches();
+    Relayout();
     return *this;
 }
 
@@ -195,8 +286,8 @@ StageCard& StageCard::AddFixed(Ctrl& c, int px, int py) {
     it.c        = &c;
     it.expand_w = 0;
 
-    if(wrap) {
-        // Wrap mode: px/py define explicit tile size; <= 0 -> use GetMinSize()
+    if(wrap || mode == ContentMode::GRID) {
+        // Wrap / grid: px/py define explicit tile size; <= 0 -> use GetMinSize()
         if(px <= 0 || py <= 0) {
             it.fixed_w  = -1;
             it.fixed_h  = -1;
@@ -217,13 +308,13 @@ StageCard& StageCard::AddFixed(Ctrl& c, int px, int py) {
 
     items.Add(it);
     contentDirty = true;
-    Layout();
+    Reflow();
     return *this;
 }
 
 StageCard& StageCard::AddFixed(Ctrl& c, int px) {
-    if(wrap)
-        return AddFixed(c, px, px); // symmetric in wrap mode
+    if(wrap || mode == ContentMode::GRID)
+        return AddFixed(c, px, px); // symmetric in wrap / grid mode
 
     contentLayer.Add(c);
     Item it;
@@ -240,18 +331,35 @@ StageCard& StageCard::AddFixed(Ctrl& c, int px) {
 
     items.Add(it);
     contentDirty = true;
-    Layout();
+    Reflow();
     return *this;
 }
 
 StageCard& StageCard::AddFixed(Ctrl& c) {
-    if(wrap) {
+    if(wrap || mode == ContentMode::GRID) {
         Size ms = c.GetMinSize();
         return AddFixed(c, ms.cx, ms.cy);
     }
     return AddFixed(c, -1);
 }
 
+StageCard& StageCard::AddSection(Ctrl& header, int h) {
+    contentLayer.Add(header);
+    Item it;
+    it.kind    = ItemKind::CtrlItem;
+    it.c       = &header;
+    it.section = true;
+    if(h > 0) {
+        it.fixed_px = h;  // STACKV main axis
+        it.fixed_h  = h;  // wrap line height
+    }
+
+    items.Add(it);
+    contentDirty = true;
+    Reflow();
+    return *this;
+}
+
 StageCard& StageCard::AddExpand(Ctrl& c, int w) {
     contentLayer.Add(c);
     Item it;
@@ -264,7 +372,7 @@ StageCard& StageCard::AddExpand(Ctrl& c, int w) {
 
     items.Add(it);
     contentDirty = true;
-    Layout();
+    Reflow();
     return *this;
 }
 
@@ -279,13 +387,537 @@ StageCard& StageCard::AddSpacer(int weight) {
 
     items.Add(it);
     contentDirty = true;
-    Layout();
+    Reflow();
+    return *this;
+}
+
+StageCard& StageCard::AddGrid(Ctrl& c, int col, int row, int colspan, int rowspan) {
+    contentLayer.Add(c);
+    Item it;
+    it.kind     = ItemKind::CtrlItem;
+    it.c        = &c;
+    it.col      = max(0, col);
+    it.row      = max(0, row);
+    it.colspan  = max(1, colspan);
+    it.rowspan  = max(1, rowspan);
+
+    items.Add(it);
+    contentDirty = true;
+    Reflow();
+    return *this;
+}
+
+// -------------------------- keyed content --------------------------
+StageCard& StageCard::SetItems(const Vector<String>& keys,
+                               Function<Ctrl *(const String& key)> factory,
+                               Event<Ctrl&, int> updater)
+{
+    if(IsVirtual())
+        ClearVirtual();
+
+    // Normally items[i] is keyed[i]; anything else means content was added
+    // around SetItems and goes away now.
+    bool foreign = items.GetCount() != keyed.GetCount();
+    for(int i = 0; !foreign && i < items.GetCount(); ++i)
+        foreign = items[i].c != ~keyed[i];
+    if(foreign) {
+        Index<Ctrl *> own;
+        for(int q = 0; q < keyed.GetCount(); ++q)
+            own.Add(~keyed[q]);
+        for(const Item& it : items)
+            if(it.c && own.Find(it.c) < 0)
+                it.c->Remove();
+        CancelPopulate();
+        populated.Clear();
+    }
+    auto OldItem = [&](int q) {
+        if(!foreign)
+            return q;
+        for(int i = 0; i < items.GetCount(); ++i)
+            if(items[i].c == ~keyed[q])
+                return i;
+        return -1;
+    };
+
+    Vector<Item>& rebuilt = scratch.rebuilt;
+    rebuilt.SetCount(0);
+    ReserveScratch(rebuilt, keys.GetCount());
+    VectorMap<String, One<Ctrl>> next;
+    int first = INT_MAX; // first item index that differs
+    for(const String& key : keys) {
+        if(next.Find(key) >= 0)
+            continue; // duplicate key, the first one wins
+        const int at = rebuilt.GetCount();
+        const int q  = keyed.Find(key);
+        const int o  = q >= 0 ? OldItem(q) : -1;
+        Item it;
+        if(o >= 0)
+            it = items[o];
+        if(q >= 0)
+            next.Add(key, pick(keyed[q]));
+        else {
+            Ctrl *c = factory(key);
+            if(!c)
+                continue;
+            next.Add(key).Attach(c);
+            contentLayer.Add(*c);
+        }
+        it.c = ~next.Top();
+        if(o != at) {
+            first = min(first, at);
+            if(updater)
+                updater(*it.c, at);
+        }
+        rebuilt.Add(it);
+    }
+    if(rebuilt.GetCount() != items.GetCount())
+        first = min(first, rebuilt.GetCount());
+
+    // Survivors were picked out of keyed; what is left are the vanished keys
+    for(int q = 0; q < keyed.GetCount(); ++q)
+        if(keyed[q])
+            keyed[q]->Remove();
+    keyed = pick(next);
+    if(first == INT_MAX && !foreign)
+        return *this; // same keys, same order
+
+    Swap(items, rebuilt);
+    if(filter)
+        first = min(first, FilterItems(first, false));
+    const int moved = SortItems();
+    if(moved != INT_MAX) {
+        first = min(first, moved);
+        SyncKeyedOrder();
+    }
+    if(foreign)
+        ResetLayoutCaches();
+    else
+        ItemsChangedFrom(first);
+    contentDirty = true;
+    Relayout();
+    return *this;
+}
+
+Ctrl* StageCard::FindKeyed(const String& key) const {
+    const int q = keyed.Find(key);
+    return q >= 0 ? ~keyed[q] : nullptr;
+}
+
+// Controls the card created (SetItems, Populate) go with the content
+void StageCard::ClearOwned() {
+    CancelPopulate();
+    keyed.Clear();
+    populated.Clear();
+}
+
+// -------------------------- time-sliced population --------------------------
+StageCard& StageCard::Populate(Function<Ctrl *()> next, int budget_ms) {
+    if(!populator)
+        populator.Create();
+    populator->next   = next;
+    populator->budget = max(1, budget_ms);
+    PopulateSlice();
+    return *this;
+}
+
+StageCard& StageCard::CancelPopulate() {
+    if(populator) { // kept once created: a slice may be running its tick
+        populator->tick.Kill();
+        populator->next.Clear();
+    }
+    return *this;
+}
+
+// Add controls until the budget is spent, then lay out once (appends only
+// place the tail) and yield to the event loop.
+void StageCard::PopulateSlice() {
+    if(!populator || !populator->next)
+        return;
+    Populator& pp = *populator;
+    const int t0 = msecs();
+    bool done = false;
+    ++batch;
+    do {
+        Ctrl *c = pp.next();
+        if(!c) {
+            done = true;
+            break;
+        }
+        populated.Add(c);
+        AddFixed(*c);
+    }
+    while(msecs(t0) < pp.budget);
+    --batch;
+    Relayout();
+    if(done) {
+        pp.next.Clear();
+        WhenPopulated();
+    }
+    else
+        pp.tick.KillPost([this] { PopulateSlice(); });
+}
+
+// -------------------------- filter / order --------------------------
+// Hide (out) or restore one item; controls the user hid are left alone.
+bool StageCard::FilterItem(Item& it, bool out) {
+    if(!it.c || it.section || out == it.filtered)
+        return false;
+    if(out) {
+        if(!it.c->IsShown())
+            return false;
+        it.filtered = true;
+        it.c->Hide(); // a culled control stays out of the layer until it is on screen
+    } else {
+        it.filtered = false;
+        it.c->Show(); // culling hides it again if it is off screen
+    }
+    return true;
+}
+
+// Returns the first item whose visibility changed, INT_MAX if none did.
+int StageCard::FilterItems(int from, bool narrowing) {
+    int first = INT_MAX;
+    for(int i = from; i < items.GetCount(); ++i) {
+        Item& it = items[i];
+        if(!it.c || (narrowing && it.filtered))
+            continue;
+        if(FilterItem(it, filter && !filter(*it.c)))
+            first = min(first, i);
+    }
+    return first;
+}
+
+// Sorts each run of plain control items; returns the first slot that moved.
+int StageCard::SortItems() {
+    if(!order)
+        return INT_MAX;
+    auto Plain = [](const Item& it) { return it.kind == ItemKind::CtrlItem && it.c && !it.section; };
+    Vector<Item>& run = scratch.rebuilt;
+    int first = INT_MAX;
+    const int n = items.GetCount();
+    for(int a = 0; a < n; ) {
+        if(!Plain(items[a])) {
+            ++a;
+            continue;
+        }
+        int b = a;
+        while(b < n && Plain(items[b]))
+            ++b;
+        run.SetCount(0);
+        ReserveScratch(run, b - a);
+        for(int i = a; i < b; ++i)
+            run.Add(items[i]);
+        StableSort(run, [&](const Item& x, const Item& y) { return order(*x.c, *y.c); });
+        for(int k = 0; k < run.GetCount(); ++k)
+            if(items[a + k].c != run[k].c) {
+                first = min(first, a + k);
+                items[a + k] = run[k];
+            }
+        a = b;
+    }
+    return first;
+}
+
+// keyed follows item order, so SetItems finds its controls by position
+void StageCard::SyncKeyedOrder() {
+    if(keyed.IsEmpty())
+        return;
+    Index<Ctrl *> at;
+    for(int q = 0; q < keyed.GetCount(); ++q)
+        at.Add(~keyed[q]);
+    VectorMap<String, One<Ctrl>> next;
+    for(const Item& it : items) {
+        const int q = it.c ? at.Find(it.c) : -1;
+        if(q >= 0)
+            next.Add(keyed.GetKey(q), pick(keyed[q]));
+    }
+    for(int q = 0; q < keyed.GetCount(); ++q)
+        if(keyed[q]) // not an item any more, keep owning it
+            next.Add(keyed.GetKey(q), pick(keyed[q]));
+    keyed = pick(next);
+}
+
+StageCard& StageCard::SetFilter(Gate<const Ctrl&> pred, bool narrowing) {
+    filter = pred;
+    const int first = FilterItems(0, narrowing && filter);
+    if(first != INT_MAX) {
+        ItemsChangedFrom(first);
+        Relayout();
+    }
+    return *this;
+}
+
+StageCard& StageCard::ClearFilter() {
+    return SetFilter(Gate<const Ctrl&>());
+}
+
+StageCard& StageCard::SetOrder(Function<bool (const Ctrl&, const Ctrl&)> less) {
+    order = less;
+    const int first = SortItems();
+    if(first != INT_MAX) {
+        SyncKeyedOrder();
+        ItemsChangedFrom(first);
+        Relayout();
+    }
+    return *this;
+}
+
+// -------------------------- drag reorder --------------------------
+Point StageCard::ContentPoint(Ctrl& from, Point p) const {
+    return p + from.GetScreenView().TopLeft() - contentLayer.GetScreenView().TopLeft();
+}
+
+void StageCard::ChildMouseEvent(Ctrl *child, int event, Point p, int zdelta, dword keyflags) {
+    ParentCtrl::ChildMouseEvent(child, event, p, zdelta, keyflags);
+    if(!dragReorder || IsVirtual() || mode != ContentMode::STACK)
+        return;
+    if(!drag)
+        drag.Create(); // first press on a reorderable card
+    DragState& dr = *drag;
+    if(dr.active)
+        return;
+    if(event == LEFTDOWN) {
+        // the item is the content-layer child that contains `child`
+        Ctrl *q = child;
+        while(q && q->GetParent() != &contentLayer)
+            q = q->GetParent();
+        dr.item = -1;
+        for(int i = 0; q && i < items.GetCount(); ++i)
+            if(items[i].c == q && !items[i].section) {
+                dr.item  = i;
+                dr.start = ContentPoint(*child, p);
+                dr.grab  = dr.start - q->GetRect().TopLeft();
+                break;
+            }
+    }
+    else if(event == LEFTUP)
+        dr.item = -1;
+    else if(event == MOUSEMOVE && dr.item >= 0 && (keyflags & K_MOUSELEFT)) {
+        const Point d = ContentPoint(*child, p) - dr.start;
+        if(max(abs(d.x), abs(d.y)) >= DPI(4)) {
+            DragBegin();
+            DragMove(ContentPoint(*child, p));
+        }
+    }
+}
+
+// Without a header pane the card is what the mouse hits over the header
+// band, so it tracks header hover and press itself.
+void StageCard::MouseMove(Point p, dword keyflags) {
+    if(drag && drag->active)
+        DragMove(ContentPoint(*this, p));
+    else if(!headerPane) {
+        const bool in = lastHeaderRc.Contains(p);
+        if(in && !headerHot_)
+            OnHeaderMouseEnter(p, keyflags);
+        else if(!in && headerHot_)
+            OnHeaderMouseLeave();
+    }
+}
+
+void StageCard::MouseLeave() {
+    if(!headerPane && headerHot_)
+        OnHeaderMouseLeave();
+}
+
+void StageCard::LeftDown(Point p, dword keyflags) {
+    if(!headerPane && lastHeaderRc.Contains(p))
+        OnHeaderLeftDown(p, keyflags);
+}
+
+void StageCard::LeftUp(Point p, dword keyflags) {
+    DragEnd(true);
+    if(headerDown_)
+        OnHeaderLeftUp(p, keyflags); // capture is on the card, the pane never sees this
+}
+
+void StageCard::CancelMode() {
+    DragEnd(false);
+}
+
+void StageCard::DragBegin() {
+    DragState& d = *drag;
+    d.vis.SetCount(0);
+    d.slots.SetCount(0);
+    d.from = -1;
+    for(int i = 0; i < items.GetCount() && d.item >= 0; ++i) {
+        const Item& it = items[i];
+        if(!IsItemShown(it))
+            continue;
+        if(i == d.item)
+            d.from = d.vis.GetCount();
+        d.vis.Add(i);
+        d.slots.Add(it.c->GetRect());
+    }
+    if(d.from < 0) {
+        d.item = -1;
+        return;
+    }
+    d.order.SetCount(d.vis.GetCount());
+    for(int k = 0; k < d.order.GetCount(); ++k)
+        d.order[k] = k;
+    d.at   = d.from;
+    d.drop = d.slots[d.from];
+
+    // The ghost is painted from one snapshot, the item itself steps aside
+    Ctrl& c = *items[d.item].c;
+    const Size sz = c.GetSize();
+    ImageDraw iw(sz);
+    c.DrawCtrl(iw);
+    Image snap = iw;
+    ImageBuffer ib(snap);
+    RGBA *t = ~ib;
+    for(int i = 0; i < ib.GetLength(); ++i) { // 70 % opacity, premultiplied
+        t[i].r = t[i].r * 7 / 10;
+        t[i].g = t[i].g * 7 / 10;
+        t[i].b = t[i].b * 7 / 10;
+        t[i].a = t[i].a * 7 / 10;
+    }
+    d.ghost.Create();
+    d.ghost->img = ib;
+    d.ghost->SetRect(d.drop.Offseted(contentLayer.GetRect().TopLeft()));
+    contentPane.Add(*d.ghost); // above the layer, not one of its items
+    c.Hide();
+    d.active = true;
+    SetCapture();
+}
+
+// Slots are in layout order: rows go down (STACKV, wrap), tiles within a
+// row go right, so the target is two binary searches away.
+int StageCard::DragSlotAt(Point q) const {
+    const Vector<Rect>& s = drag->slots;
+    const bool by_x = !IsWrap() && dir == Direction::H;
+    auto Key = [&](const Rect& r) { return by_x ? r.left : r.top; };
+    const int at = by_x ? q.x : q.y;
+    int lo = 0, hi = s.GetCount() - 1; // last slot starting at or before `at`
+    while(lo < hi) {
+        const int mid = (lo + hi + 1) / 2;
+        if(Key(s[mid]) <= at) lo = mid;
+        else                  hi = mid - 1;
+    }
+    if(!IsWrap())
+        return lo;
+    int row = lo; // first slot of that row
+    for(int l = 0, h = lo; l < h; ) {
+        const int mid = (l + h) / 2;
+        if(s[mid].top < s[lo].top) l = row = mid + 1;
+        else                       h = row = mid;
+    }
+    int k = lo;
+    while(k > row && s[k].left > q.x)
+        --k;
+    return k;
+}
+
+// Re-place the items previewed in slots [lo, hi]; sizes come from the drag
+// start, everything outside the range keeps its rect.
+void StageCard::DragPreview(int lo, int hi) {
+    DragState& d = *drag;
+    const bool stack = !IsWrap();
+    const bool vert  = dir == Direction::V;
+    int pos = vert ? d.slots[lo].top : d.slots[lo].left;
+    for(int k = lo; k <= hi; ++k) {
+        const int  o  = d.order[k];
+        const Rect sr = d.slots[o];
+        Rect r;
+        if(!stack)
+            r = RectC(d.slots[k].left, d.slots[k].top, sr.GetWidth(), sr.GetHeight());
+        else if(vert) {
+            r = RectC(sr.left, pos, sr.GetWidth(), sr.GetHeight());
+            pos = r.bottom + (k + 1 < d.slots.GetCount() ? d.slots[k + 1].top - d.slots[k].bottom : 0);
+        } else {
+            r = RectC(pos, sr.top, sr.GetWidth(), sr.GetHeight());
+            pos = r.right + (k + 1 < d.slots.GetCount() ? d.slots[k + 1].left - d.slots[k].right : 0);
+        }
+        if(o == d.from)
+            d.drop = r;
+        else
+            items[d.vis[o]].c->SetRect(r);
+    }
+}
+
+void StageCard::DragMove(Point q) {
+    DragState& d = *drag;
+    if(!d.active)
+        return;
+    d.ghost->SetRect(Rect(q - d.grab + contentLayer.GetRect().TopLeft(), d.slots[d.from].GetSize()));
+    const int at = DragSlotAt(q);
+    if(at == d.at)
+        return;
+    // Only the slots between the previous and the new target change
+    const int lo = min(at, d.at), hi = max(at, d.at);
+    const int o  = d.order[d.at];
+    d.order.Remove(d.at);
+    d.order.Insert(at, o);
+    d.at = at;
+    DragPreview(lo, hi);
+}
+
+void StageCard::DragEnd(bool commit) {
+    if(!drag)
+        return;
+    DragState& d = *drag;
+    const int pressed = d.item;
+    d.item = -1;
+    if(!d.active)
+        return;
+    d.active = false;
+    d.ghost.Clear(); // removes it from the pane
+    if(HasCapture())
+        ReleaseCapture();
+
+    Ctrl& c = *items[pressed].c;
+    const int from = d.from, to = d.at;
+    if(!commit || from == to) {
+        for(int k = min(from, to); k <= max(from, to); ++k)
+            items[d.vis[k]].c->SetRect(d.slots[k]);
+        c.Show();
+        return;
+    }
+    c.SetRect(d.drop);
+    c.Show();
+
+    const int a = d.vis[from], b = d.vis[to];
+    Item it = items[a];
+    items.Remove(a);
+    items.Insert(b, it);
+    order.Clear(); // the user's order wins over SetOrder
+    SyncKeyedOrder();
+    ItemsChangedFrom(min(a, b));
+    Relayout();
+    WhenReorder(a, b);
+}
+
+// -------------------------- grid tracks --------------------------
+StageCard& StageCard::SetGridColumn(int i, int px, int weight) {
+    if(i < 0) return *this;
+    GridTrack& t = gridColSpec.At(i);
+    t.px     = max(0, px);
+    t.weight = max(0, weight);
+    Relayout();
+    return *this;
+}
+
+StageCard& StageCard::SetGridRow(int i, int px, int weight) {
+    if(i < 0) return *this;
+    GridTrack& t = gridRowSpec.At(i);
+    t.px     = max(0, px);
+    t.weight = max(0, weight);
+    Relayout();
+    return *this;
+}
+
+StageCard& StageCard::ClearGridTracks() {
+    gridColSpec.Clear();
+    gridRowSpec.Clear();
+    Relayout();
     return *this;
 }
 
 StageCard& StageCard::ClearHeader() {
-    ClearChildren(headerPane);
-    Layout();
+    if(headerPane)
+        ClearChildren(*headerPane);
+    Relayout();
     return *this;
 }
 
@@ -294,14 +926,14 @@ int StageCard::HeaderHeight() const {
     int h = headerInset.top;
 
     if(!title.IsEmpty()) {
-        h += metrics_.titleFont.GetCy();
-        if(metrics_.titleUnderlineTh > 0 && !underlineVertical)
-            h += metrics_.headerGap + metrics_.titleUnderlineTh;
-        h += metrics_.headerGap;
+        h += Metrics().titleFont.GetCy();
+        if(Metrics().titleUnderlineTh > 0 && !underlineVertical)
+            h += Metrics().headerGap + Metrics().titleUnderlineTh;
+        h += Metrics().headerGap;
     }
     if(!subTitle.IsEmpty()) {
-        h += metrics_.subTitleFont.GetCy();
-        h += metrics_.headerGap;
+        h += Metrics().subTitleFont.GetCy();
+        h += Metrics().headerGap;
     }
     h += headerInset.bottom;
     return max(h, DPI(12));
@@ -319,8 +951,8 @@ Size StageCard::GetMinSize() const {
 }
 
 void StageCard::MouseWheel(Point, int zdelta, dword) {
-    if(!scrollEnabled || !vbar.IsShown()) return;
-    vbar.Wheel(zdelta);
+    if(!scrollEnabled || !IsScrollShown()) return;
+    vbar->Wheel(zdelta);
 }
 
 void StageCard::ClearChildren(ParentCtrl& p) {
@@ -332,20 +964,31 @@ void StageCard::ClearChildren(ParentCtrl& p) {
 }
 
 void StageCard::RebuildItemsFromChildrenIfNeeded() {
+    if(IsVirtual())
+        return; // content children are the recycle pool, not items
+
     int child_count = 0;
     for(Ctrl* q = contentLayer.GetFirstChild(); q; q = q->GetNext())
         ++child_count;
 
-    int known_ctrls = 0;
+    int known_ctrls = 0; // culled items are out of the layer, not gone
     for(const Item& it : items)
-        if(it.kind == ItemKind::CtrlItem)
+        if(it.kind == ItemKind::CtrlItem && !it.culled)
             ++known_ctrls;
 
     if(known_ctrls == child_count)
         return;
 
-    Vector<Item> rebuilt;
-    rebuilt.Reserve(child_count);
+    if(cullIndex && cullIndex->culled) { // rebuild from the full set, in item order
+        UncullAll();
+        child_count = 0;
+        for(Ctrl* q = contentLayer.GetFirstChild(); q; q = q->GetNext())
+            ++child_count;
+    }
+
+    Vector<Item>& rebuilt = scratch.rebuilt;
+    rebuilt.SetCount(0);
+    ReserveScratch(rebuilt, child_count);
     for(Ctrl* q = contentLayer.GetFirstChild(); q; q = q->GetNext()) {
         int idx = -1;
         for(int i = 0; i < items.GetCount(); ++i)
@@ -367,7 +1010,8 @@ void StageCard::RebuildItemsFromChildrenIfNeeded() {
         if(it.kind == ItemKind::Spacer)
             rebuilt.Add(it);
 
-    items = pick(rebuilt);
+    Swap(items, rebuilt); // the old buffer stays in scratch for next time
+    ResetLayoutCaches();
 }
 
 // Effective content inset = user inset only
@@ -377,23 +1021,77 @@ Rect StageCard::EffectiveContentInset() const {
     return contentInnerInset;
 }
 
-int StageCard::MeasureNaturalPrimaryForWidth(int) const {
+// Content height (inner insets included) needed at content width pane_w.
+int StageCard::MeasureNaturalPrimaryForWidth(int pane_w) const {
     Rect eff = EffectiveContentInset();
-    int total = eff.top + eff.bottom;
-    int gaps  = 0;
-    bool first = true;
-    for(const Item& it : items) {
-        if(it.kind == ItemKind::Spacer) continue;
-        if(!it.c || !it.c->IsShown()) continue;
-        Size ms = it.c->GetMinSize();
-        int h = (it.fixed_px >= 0) ? it.fixed_px : ms.cy;
-        if(!first) gaps += contentGap.cy;
-        total += h;
-        first = false;
+    const int avail_w = max(0, pane_w - eff.left - eff.right);
+
+    if(IsVirtual() && virt->stack)
+        return eff.top + max(0, virt->tree.Total() - contentGap.cy) + eff.bottom;
+
+    if(IsUniformWrap()) {
+        int shown = 0; // cells go to shown items only, as in LayoutWrapUniform
+        for(const Item& it : items)
+            if(it.kind != ItemKind::Spacer && IsItemShown(it))
+                ++shown;
+        const int cols = max(1, (avail_w + contentGap.cx) / (wrapItem.cx + contentGap.cx));
+        const int rows = (shown + cols - 1) / cols;
+        return eff.top + max(0, rows * (wrapItem.cy + contentGap.cy) - contentGap.cy) + eff.bottom;
+    }
+
+    if(IsWrap() && !IsJustifiedWrap() && !IsVirtual()) {
+        // Greedy line breaking over natural sizes, same rules as LayoutWrapH
+        int y = 0, x = 0, line_h = 0;
+        bool line = false;
+        for(const Item& it : items) {
+            if(it.kind == ItemKind::Spacer || !IsItemShown(it)) continue;
+            Size sz = it.nat;
+            if(!it.measured) {
+                const Size ms = it.fixed_w >= 0 && it.fixed_h >= 0 ? Size(0, 0) : it.c->GetMinSize();
+                sz = Size(it.fixed_w >= 0 ? it.fixed_w : ms.cx, it.fixed_h >= 0 ? it.fixed_h : ms.cy);
+            }
+            if(it.section)
+                sz.cx = avail_w;
+            if(line && (it.section || x + sz.cx > avail_w)) {
+                y += line_h + contentGap.cy;
+                x = line_h = 0;
+            }
+            x += sz.cx + contentGap.cx;
+            line_h = max(line_h, sz.cy);
+            line = true;
+            if(it.section)
+                x = avail_w + 1; // nothing shares a header line
+        }
+        return eff.top + y + line_h + eff.bottom;
     }
-    return max(total + gaps, DPI(10));
-}
 
+    if(mode == ContentMode::STACK && dir == Direction::V && !IsVirtual()) {
+        // Mirrors LayoutStackV's "needed": natural rows + expand baseline
+        int total = 0, cnt = 0, expand_min = 0, expand_cnt = 0;
+        for(const Item& it : items) {
+            if(it.kind == ItemKind::Spacer) { ++cnt; continue; }
+            if(!IsItemShown(it)) continue;
+            ++cnt;
+            int h;
+            if(it.fixed_px >= 0)
+                h = it.fixed_px;
+            else if(UsesHeightForWidth(it))
+                h = static_cast<const StageCard *>(it.c)->GetHeightForWidth(avail_w);
+            else
+                h = it.c->GetMinSize().cy;
+            if(it.expand_w > 0) {
+                expand_min = max(expand_min, h);
+                ++expand_cnt;
+            } else
+                total += h;
+        }
+        total += expand_min * expand_cnt + (cnt > 0 ? (cnt - 1) * contentGap.cy : 0);
+        return max(eff.top + total + eff.bottom, DPI(10));
+    }
+
+    // Other modes: the last laid out extent is the best we know
+    return virtualLen;
+}
 int StageCard::MeasureNaturalPrimaryForHeight(int) const {
     Rect eff = EffectiveContentInset();
     int total = eff.left + eff.right;
@@ -401,7 +1099,7 @@ int StageCard::MeasureNaturalPrimaryForHeight(int) const {
     bool first = true;
     for(const Item& it : items) {
         if(it.kind == ItemKind::Spacer) continue;
-        if(!it.c || !it.c->IsShown()) continue;
+        if(!IsItemShown(it)) continue;
         Size ms = it.c->GetMinSize();
         int w = (it.fixed_px >= 0) ? it.fixed_px : ms.cx;
         if(!first) gaps += contentGap.cx;
@@ -411,339 +1109,1252 @@ int StageCard::MeasureNaturalPrimaryForHeight(int) const {
     return max(total + gaps, DPI(10));
 }
 
+// Stack and ragged wrap geometry comes from the headless solver
+// (StageLayout.h); these functions only gather specs from the children
+// and stage the resulting rects.
+StageFrame StageCard::ContentFrame(const Rect& inner) const {
+    StageFrame f;
+    f.viewport = inner.GetSize();
+    f.inset    = EffectiveContentInset();
+    f.gap      = contentGap;
+    return f;
+}
+
+// The only pass that touches the child controls: visibility and natural size
+void StageCard::GatherStackSpecs(bool vertical, int cross) {
+    StageSpecs&    sp   = scratch.stack;
+    Vector<Ctrl*>& ctrl = scratch.stackCtrl;
+    const int n = items.GetCount();
+    sp.Clear();
+    ctrl.SetCount(0);
+    sp.Reserve(n);
+    ReserveScratch(ctrl, n);
+
+    for(const Item& it : items) {
+        if(it.kind == ItemKind::Spacer) {
+            sp.Add(0, 0, it.expand_w, StageSpecs::SPACER);
+            ctrl.Add(nullptr);
+            continue;
+        }
+        if(!IsItemShown(it))
+            continue;
+        int nat;
+        if(it.fixed_px >= 0)
+            nat = it.fixed_px;
+        else if(!vertical)
+            nat = it.c->GetMinSize().cx;
+        else if(UsesHeightForWidth(it))
+            nat = static_cast<StageCard *>(it.c)->GetHeightForWidth(cross);
+        else
+            nat = it.c->GetMinSize().cy;
+        sp.Add(vertical ? cross : nat, vertical ? nat : cross, it.expand_w);
+        ctrl.Add(it.c);
+    }
+}
+
 void StageCard::LayoutStackV(const Rect& inner) {
+    if(IsVirtual() && virt->stack) {
+        LayoutVirtualStack(inner);
+        return;
+    }
+
+    const StageFrame f = ContentFrame(inner);
+    GatherStackSpecs(true, f.AvailW());
+    StageGeometry& g = scratch.geom;
+    if(layoutMemo)
+        StageSolveStackMemo(scratch.stack, true, f, g);
+    else
+        StageSolveStack(scratch.stack, true, f, g);
+    virtualLen = g.virtualLen;
+
+    const Vector<Ctrl*>& ctrl = scratch.stackCtrl;
+    for(int i = 0; i < ctrl.GetCount(); ++i)
+        if(ctrl[i])
+            Place(*ctrl[i], g.rects[i]);
+
+    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+}
+
+void StageCard::LayoutStackH(const Rect& inner) {
+    const StageFrame f = ContentFrame(inner);
+    GatherStackSpecs(false, f.AvailH());
+    StageGeometry& g = scratch.geom;
+    if(layoutMemo)
+        StageSolveStackMemo(scratch.stack, false, f, g);
+    else
+        StageSolveStack(scratch.stack, false, f, g);
+    virtualLen = g.virtualLen;
+
+    const Vector<Ctrl*>& ctrl = scratch.stackCtrl;
+    for(int i = 0; i < ctrl.GetCount(); ++i)
+        if(ctrl[i])
+            Place(*ctrl[i], g.rects[i]);
+
+    contentLayer.SetRect(-scroll_y, 0, virtualLen, inner.GetHeight());
+}
+
+
+Size StageCard::MeasureWrapItem(Item& it) {
+    if(!it.measured) {
+        if(it.fixed_w >= 0 && it.fixed_h >= 0)
+            it.nat = Size(it.fixed_w, it.fixed_h);
+        else {
+            const Size ms = it.c->GetMinSize();
+            it.nat = Size(it.fixed_w >= 0 ? it.fixed_w : ms.cx,
+                          it.fixed_h >= 0 ? it.fixed_h : ms.cy);
+        }
+        it.measured = true;
+    }
+    return it.nat;
+}
+
+// Incremental wrap layout:
+//  - tile sizes are cached on the Item (MeasureWrapItem), so re-breaking
+//    lines never calls back into the child controls;
+//  - prefix sums of (w + gap) turn "how many tiles fit on this line" into a
+//    binary search;
+//  - work restarts at the line holding the first changed tile (the tail
+//    line for appends), and lines whose head did not move skip SetRect.
+void StageCard::LayoutWrapH(const Rect& inner) {
+    if(IsVirtual()) {
+        LayoutVirtualWrap(inner);
+        return;
+    }
+    if(IsJustifiedWrap()) {
+        LayoutWrapJustified(inner);
+        return;
+    }
+    if(IsUniformWrap()) {
+        LayoutWrapUniform(inner);
+        return;
+    }
+
+    const StageFrame f = ContentFrame(inner);
+    WrapCache& wc = wrapCache;
+
+    // Visible items of this pass; measure the ones we have not seen yet
+    Vector<int>& vis = wc.scratch;
+    StageSpecs&  sp  = wc.specs;
+    vis.SetCount(0);
+    sp.Clear();
+    for(int i = 0; i < items.GetCount(); ++i) {
+        Item& it = items[i];
+        if(it.kind == ItemKind::Spacer) continue;
+        if(!IsItemShown(it))   continue;
+        const Size nat = MeasureWrapItem(it);
+        sp.Add(nat.cx, nat.cy, 0, it.section ? StageSpecs::BREAK : 0);
+        vis.Add(i);
+    }
+    const int n = vis.GetCount();
+
+    // keep = length of the unchanged prefix (same items, same order)
+    int keep = 0;
+    const int old_n = wc.idx.GetCount();
+    while(keep < n && keep < old_n && wc.idx[keep] == vis[keep])
+        ++keep;
+    Swap(wc.idx, vis);
+
+    // Tiles that did not move are not staged at all
+    virtualLen = wc.solver.Solve(sp, keep, f, wc.changed);
+    const Vector<Rect>& rc = wc.solver.GetRects();
+    for(int k : wc.changed)
+        Place(*items[wc.idx[k]].c, rc[k]);
+
+    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+}
+
+// Track sizing for one grid axis, single pass over tracks + items:
+//   1. fixed tracks take their px, auto/weighted tracks start at def_px;
+//   2. single-span items grow the non-fixed track they sit in;
+//   3. spanning items spread what they still miss over their non-fixed tracks;
+//   4. leftover space goes to weighted tracks by weight.
+void StageCard::SizeGridTracks(const Vector<GridTrack>& spec, int count, int def_px, int def_weight,
+                               const Vector<int>& at, const Vector<int>& span, const Vector<int>& nat,
+                               int gap, int avail, Vector<int>& pos, Vector<int>& size)
+{
+    auto Fixed  = [&](int t) { return t < spec.GetCount() ? spec[t].px : 0; };
+    auto Weight = [&](int t) {
+        if(t < spec.GetCount() && (spec[t].px > 0 || spec[t].weight > 0))
+            return spec[t].px > 0 ? 0 : spec[t].weight;
+        return def_weight;
+    };
+
+    size.SetCount(count);
+    pos.SetCount(count);
+    int total_weight = 0;
+    for(int t = 0; t < count; ++t) {
+        const int px = Fixed(t);
+        size[t] = px > 0 ? px : def_px;
+        total_weight += Weight(t);
+    }
+
+    for(int i = 0; i < at.GetCount(); ++i)
+        if(span[i] == 1 && Fixed(at[i]) <= 0)
+            size[at[i]] = max(size[at[i]], nat[i]);
+
+    for(int i = 0; i < at.GetCount(); ++i) {
+        if(span[i] <= 1) continue;
+        int have = (span[i] - 1) * gap;
+        int flex = 0;
+        for(int t = at[i]; t < at[i] + span[i]; ++t) {
+            have += size[t];
+            if(Fixed(t) <= 0) ++flex;
+        }
+        const int need = nat[i] - have;
+        if(need <= 0 || flex == 0) continue;
+        int rest = need % flex;
+        for(int t = at[i]; t < at[i] + span[i]; ++t)
+            if(Fixed(t) <= 0) {
+                size[t] += need / flex + (rest > 0 ? 1 : 0);
+                --rest;
+            }
+    }
+
+    int used = count > 0 ? (count - 1) * gap : 0;
+    for(int t = 0; t < count; ++t)
+        used += size[t];
+    int extra = avail - used;
+    if(extra > 0 && total_weight > 0) {
+        int given = 0, last = -1;
+        for(int t = 0; t < count; ++t) {
+            const int w = Weight(t);
+            if(w <= 0) continue;
+            const int share = extra * w / total_weight;
+            size[t] += share;
+            given   += share;
+            last     = t;
+        }
+        if(last >= 0)
+            size[last] += extra - given; // rounding remainder
+    }
+
+    int p = 0;
+    for(int t = 0; t < count; ++t) {
+        pos[t] = p;
+        p += size[t] + gap;
+    }
+}
+
+void StageCard::LayoutGrid(const Rect& inner) {
     Rect eff = EffectiveContentInset();
     int insetL = eff.left;
     int insetR = eff.right;
     int insetT = eff.top;
     int insetB = eff.bottom;
 
-    struct Row {
-        bool spacer;
-        bool is_expand;
-        int  expand;
-        Ctrl* c;
-        int  nat_h;   // natural height of the child (header, etc.)
-    };
-    Vector<Row> rows; rows.Reserve(items.GetCount());
+    const int avail_w = max(0, inner.GetWidth()  - insetL - insetR);
+    const int avail_h = max(0, inner.GetHeight() - insetT - insetB);
 
-    const int inner_w = max(0, inner.GetWidth()  - insetL - insetR);
-    const int inner_h = max(0, inner.GetHeight() - insetT - insetB);
+    // Column count: requested count, specified tracks, explicit placements
+    int cols = max(gridCols, gridColSpec.GetCount());
+    for(const Item& it : items)
+        if(it.kind == ItemKind::CtrlItem && it.col >= 0)
+            cols = max(cols, it.col + it.colspan);
+
+    LayoutScratch& ls = scratch;
+    Vector<int> *grid_in[] = { &ls.vis, &ls.col, &ls.colspan, &ls.row, &ls.rowspan, &ls.natw, &ls.nath };
+    for(Vector<int> *v : grid_in) {
+        v->SetCount(0);
+        ReserveScratch(*v, items.GetCount());
+    }
+    Vector<int>& vis = ls.vis;   Vector<int>& col = ls.col;         Vector<int>& colspan = ls.colspan;
+    Vector<int>& row = ls.row;   Vector<int>& rowspan = ls.rowspan;
+    Vector<int>& natw = ls.natw; Vector<int>& nath = ls.nath;
+    // Explicit placements first: the auto-flow cursor skips the cells they hold
+    Vector<byte>& taken = ls.taken;
+    taken.SetCount(0);
+    for(const Item& it : items)
+        if(it.kind == ItemKind::CtrlItem && it.col >= 0 && IsItemShown(it)) {
+            const int r1 = it.row + it.rowspan, c1 = min(cols, it.col + it.colspan);
+            if(taken.GetCount() < r1 * cols)
+                taken.SetCount(r1 * cols, 0);
+            for(int r = it.row; r < r1; ++r)
+                for(int c = it.col; c < c1; ++c)
+                    taken[r * cols + c] = 1;
+        }
 
-    int natural_fixed = 0;    // sum of non-expand row naturals
-    int expand_weight = 0;    // total expand weight
-    int expand_min    = 0;    // max natural among expand rows
-    int expand_count  = 0;    // number of expand rows
+    int rows = gridRowSpec.GetCount();
+    int flow = 0; // auto-flow cursor, row by row
+    for(int i = 0; i < items.GetCount(); ++i) {
+        const Item& it = items[i];
+        if(it.kind == ItemKind::Spacer) continue;
+        if(!IsItemShown(it))   continue;
 
-    // Collect rows and measure
-    for(const Item& it : items) {
-        if(it.kind == ItemKind::Spacer) {
-            bool is_exp = (it.expand_w > 0);
-            rows.Add({true, is_exp, max(1, it.expand_w), nullptr, 0});
-            if(is_exp) {
-                expand_weight += max(1, it.expand_w);
-                expand_count++;
-            }
-            continue;
+        int c, r;
+        if(it.col >= 0) {
+            c = it.col;
+            r = it.row;
+        } else {
+            while(flow < taken.GetCount() && taken[flow])
+                ++flow;
+            c = flow % cols;
+            r = flow / cols;
+            ++flow;
         }
+        const int cs = min(it.colspan, cols - c);
+        const Size ms = (it.fixed_w >= 0 && it.fixed_h >= 0) ? Size(it.fixed_w, it.fixed_h)
+                                                             : it.c->GetMinSize();
+        vis.Add(i);
+        col.Add(c);
+        colspan.Add(cs);
+        row.Add(r);
+        rowspan.Add(it.rowspan);
+        natw.Add(it.fixed_w >= 0 ? it.fixed_w : ms.cx);
+        nath.Add(it.fixed_h >= 0 ? it.fixed_h : ms.cy);
+        rows = max(rows, r + it.rowspan);
+    }
 
-        if(!it.c || !it.c->IsShown())
-            continue;
+    Vector<int>& colPos = ls.colPos; Vector<int>& colSize = ls.colSize;
+    Vector<int>& rowPos = ls.rowPos; Vector<int>& rowSize = ls.rowSize;
+    ReserveScratch(colPos, cols);  ReserveScratch(colSize, cols);
+    ReserveScratch(rowPos, rows);  ReserveScratch(rowSize, rows);
+    SizeGridTracks(gridColSpec, cols, gridCell.cx, gridStretch ? 1 : 0,
+                   col, colspan, natw, contentGap.cx, avail_w, colPos, colSize);
+    SizeGridTracks(gridRowSpec, rows, gridCell.cy, 0,
+                   row, rowspan, nath, contentGap.cy, avail_h, rowPos, rowSize);
+
+    for(int k = 0; k < vis.GetCount(); ++k) {
+        const int c1 = col[k] + colspan[k] - 1;
+        const int r1 = row[k] + rowspan[k] - 1;
+        const int x  = insetL + colPos[col[k]];
+        const int y  = insetT + rowPos[row[k]];
+        Place(*items[vis[k]].c, Rect(x, y, insetL + colPos[c1] + colSize[c1],
+                                           insetT + rowPos[r1] + rowSize[r1]));
+    }
 
-        Size ms = it.c->GetMinSize();
-        int h = (it.fixed_px >= 0) ? it.fixed_px : ms.cy;
-        bool is_exp = (it.expand_w > 0);
+    const int used_w = cols > 0 ? colPos[cols - 1] + colSize[cols - 1] : 0;
+    const int used_h = rows > 0 ? rowPos[rows - 1] + rowSize[rows - 1] : 0;
+
+    virtualLen = max(avail_h, insetT + used_h + insetB);
+    contentLayer.SetRect(0, -scroll_y, max(inner.GetWidth(), insetL + used_w + insetR), virtualLen);
+}
 
-        rows.Add({false, is_exp, it.expand_w, it.c, h});
+// Justified rows: greedy with one item of lookahead. Aspect ratios are
+// accumulated until the row reaches the width at the target height; the row
+// then closes either with or without the last item, whichever leaves the
+// scaled row height closer to the target. Linear in the number of items.
+void StageCard::BreakJustifiedRows(JustifyLayout& jl, int avail_w, const Rect& eff) {
+    const Vector<int>& idx = justifyCache->idx;
+    const int    n   = idx.GetCount();
+    const int    gap = contentGap.cx;
+    const double H   = wrapJustifyH;
+
+    auto Aspect = [&](int k) {
+        const Size sz = items[idx[k]].nat;
+        return sz.cy > 0 ? double(sz.cx) / sz.cy : 1.0;
+    };
 
-        if(is_exp) {
-            expand_weight += max(1, it.expand_w);
-            expand_min    = max(expand_min, h);
-            expand_count++;
-        } else {
-            natural_fixed += h;
+    jl.width = avail_w;
+    jl.rects.SetCount(n);
+    int y = eff.top;
+
+    auto EmitRow = [&](int from, int to, double sum, bool justify) {
+        const int    cnt = to - from;
+        const double h   = justify ? (avail_w - (cnt - 1) * gap) / sum : H;
+        const int    ih  = max(1, int(h + 0.5));
+        int x = eff.left;
+        for(int k = from; k < to; ++k) {
+            const int w = (justify && k == to - 1) ? max(1, eff.left + avail_w - x) // absorb rounding
+                                                   : max(1, int(Aspect(k) * h + 0.5));
+            jl.rects[k] = RectC(x, y, w, ih);
+            x += w + gap;
         }
+        y += ih + contentGap.cy;
+    };
+    auto Off = [&](double h) { return h > 0 ? max(h / H, H / h) : 1e9; };
+
+    int    start = 0;
+    double sum   = 0;
+    for(int k = 0; k < n; ++k) {
+        const double a = Aspect(k);
+        sum += a;
+        const int cnt = k - start + 1;
+        if(sum * H + (cnt - 1) * gap < avail_w)
+            continue;
+
+        const double h_with = (avail_w - (cnt - 1) * gap) / sum;
+        if(cnt > 1) {
+            const double h_without = (avail_w - (cnt - 2) * gap) / (sum - a);
+            if(Off(h_without) < Off(h_with)) {
+                EmitRow(start, k, sum - a, true);
+                start = k;
+                sum   = a;
+                if(a * H >= avail_w) { // too wide to share a row
+                    EmitRow(k, k + 1, a, true);
+                    start = k + 1;
+                    sum   = 0;
+                }
+                continue;
+            }
+        }
+        EmitRow(start, k + 1, sum, true);
+        start = k + 1;
+        sum   = 0;
     }
+    if(start < n)
+        EmitRow(start, n, sum, false); // last row keeps the target height
 
-    const int cnt = rows.GetCount();
-    const int total_gaps = (cnt > 0 ? (cnt - 1) * contentGap.cy : 0);
+    jl.height = n > 0 ? y - contentGap.cy : eff.top;
+}
 
-    // Baseline "needed" height:
-    //  - all non-expand rows at their natural height
-    //  - all expand rows at a common baseline expand_min
-    int needed = insetT + natural_fixed + insetB + total_gaps;
-    if(expand_count > 0)
-        needed += expand_min * expand_count;
+void StageCard::LayoutWrapJustified(const Rect& inner) {
+    Rect eff = EffectiveContentInset();
+    const int avail_w = max(0, inner.GetWidth()  - eff.left - eff.right);
+    const int inner_h = max(0, inner.GetHeight() - eff.top  - eff.bottom);
 
-    const int avail = inner_h;
-    const int extra = max(0, avail - needed);
+    if(!justifyCache)
+        justifyCache.Create();
+    JustifyCache& jc = *justifyCache;
 
-    int y = insetT;
-    const int x = insetL;
-    const int w = inner_w;
+    Vector<int>& vis = jc.scratch;
+    vis.SetCount(0);
+    for(int i = 0; i < items.GetCount(); ++i) {
+        Item& it = items[i];
+        if(it.kind == ItemKind::Spacer) continue;
+        if(!IsItemShown(it))   continue;
+        MeasureWrapItem(it);
+        vis.Add(i);
+    }
 
-    virtualLen = max(inner_h, needed);
+    if(!(vis == jc.idx) || jc.inset != eff || jc.gap != contentGap || jc.target != wrapJustifyH) {
+        jc.memo.Clear();
+        Swap(jc.idx, vis);
+        jc.inset  = eff;
+        jc.gap    = contentGap;
+        jc.target = wrapJustifyH;
+    }
 
-    for(int i = 0; i < cnt; i++) {
-        int h;
+    // LRU lookup by width
+    int hit = -1;
+    for(int i = 0; i < jc.memo.GetCount(); ++i)
+        if(jc.memo[i].width == avail_w) { hit = i; break; }
+    if(hit < 0) {
+        if(jc.memo.GetCount() >= JustifyCache::MEMO)
+            jc.memo.Remove(jc.memo.GetCount() - 1);
+        jc.memo.Insert(0, new JustifyLayout);
+        BreakJustifiedRows(jc.memo[0], avail_w, eff);
+    } else if(hit > 0)
+        jc.memo.Insert(0, jc.memo.Detach(hit));
+
+    const JustifyLayout& jl = jc.memo[0];
+    for(int k = 0; k < jc.idx.GetCount(); ++k) {
+        Place(*items[jc.idx[k]].c, jl.rects[k]);
+    }
 
-        if(rows[i].is_expand && expand_weight > 0) {
-            // Split the remaining "extra" purely by weight,
-            // each expand row starts from the same baseline expand_min.
-            int share = (extra * rows[i].expand) / expand_weight;
-            h = expand_min + share;
-        } else {
-            // Fixed / non-expand rows keep their natural height
-            h = rows[i].nat_h;
+    virtualLen = max(inner_h, jl.height + eff.bottom);
+    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+}
+
+// Masonry: every item goes into the currently shortest column. Columns are
+// kept in a min-heap on (bottom, index), so placing n items into k columns
+// is O(n log k). Heights are measured once; while columns and insets stay
+// the same, a relayout resumes after the last placed item (FitScrolled
+// keeps a scrolling card at one width, so that holds across appends).
+void StageCard::LayoutMasonry(const Rect& inner) {
+    Rect eff = EffectiveContentInset();
+    const int avail_w = max(0, inner.GetWidth()  - eff.left - eff.right);
+    const int avail_h = max(0, inner.GetHeight() - eff.top  - eff.bottom);
+
+    if(!masonryCache)
+        masonryCache.Create();
+    MasonryCache& mc = *masonryCache;
+    const int cols = masonryColW > 0
+                   ? max(1, (avail_w + contentGap.cx) / (masonryColW + contentGap.cx))
+                   : max(1, masonryCols);
+    const int colw = max(0, (avail_w - (cols - 1) * contentGap.cx) / cols);
+
+    Vector<int>& vis = mc.scratch;
+    vis.SetCount(0);
+    for(int i = 0; i < items.GetCount(); ++i) {
+        Item& it = items[i];
+        if(it.kind == ItemKind::Spacer) continue;
+        if(!IsItemShown(it))   continue;
+        if(!it.measured) {
+            it.nat = Size(0, it.fixed_px >= 0 ? it.fixed_px : it.c->GetMinSize().cy);
+            it.measured = true;
         }
+        vis.Add(i);
+    }
 
-        if(!rows[i].spacer && rows[i].c)
-            rows[i].c->SetRect(Rect(x, y, x + w, y + h));
+    bool resume = mc.cols == cols && mc.colw == colw && mc.inset == eff && mc.gap == contentGap
+                  && mc.idx.GetCount() <= vis.GetCount();
+    for(int k = 0; resume && k < mc.idx.GetCount(); ++k)
+        resume = mc.idx[k] == vis[k];
+
+    if(!resume) {
+        mc.cols  = cols;
+        mc.colw  = colw;
+        mc.inset = eff;
+        mc.gap   = contentGap;
+        mc.idx.SetCount(0);
+        mc.bottom.SetCount(cols);
+        mc.heap.SetCount(cols);
+        for(int c = 0; c < cols; ++c) {
+            mc.bottom[c] = eff.top;
+            mc.heap[c]   = c; // equal bottoms: index order is a valid heap
+        }
+    }
 
-        y += h;
-        if(i + 1 < cnt)
-            y += contentGap.cy;
+    auto Less = [&](int a, int b) {
+        return mc.bottom[a] < mc.bottom[b] || (mc.bottom[a] == mc.bottom[b] && a < b);
+    };
+
+    for(int k = mc.idx.GetCount(); k < vis.GetCount(); ++k) {
+        Item& it = items[vis[k]];
+        const int c = mc.heap[0];
+        const int x = eff.left + c * (colw + contentGap.cx);
+        const int y = mc.bottom[c];
+        Place(*it.c, Rect(x, y, x + colw, y + it.nat.cy));
+        mc.bottom[c] = y + it.nat.cy + contentGap.cy;
+        mc.idx.Add(vis[k]);
+
+        // root grew: sift it down
+        int i = 0;
+        for(;;) {
+            int l = 2 * i + 1, r = l + 1, m = i;
+            if(l < cols && Less(mc.heap[l], mc.heap[m])) m = l;
+            if(r < cols && Less(mc.heap[r], mc.heap[m])) m = r;
+            if(m == i) break;
+            Swap(mc.heap[i], mc.heap[m]);
+            i = m;
+        }
     }
 
+    int used = eff.top;
+    for(int c = 0; c < cols; ++c)
+        used = max(used, mc.bottom[c] - (mc.bottom[c] > eff.top ? contentGap.cy : 0));
+
+    virtualLen = max(avail_h, used + eff.bottom);
     contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
 }
 
+Rect StageCard::UniformTileRect(int cell) const {
+    const Rect eff  = EffectiveContentInset();
+    const int  cols = max(1, wrapCache.cols);
+    const int  x = eff.left + (cell % cols) * (wrapItem.cx + contentGap.cx);
+    const int  y = eff.top  + (cell / cols) * (wrapItem.cy + contentGap.cy);
+    return RectC(x, y, wrapItem.cx, wrapItem.cy);
+}
 
-void StageCard::LayoutStackH(const Rect& inner) {
+// Uniform tiles: position is a function of the cell index only. Shown items
+// take consecutive cells (hidden / filtered items and spacers take none),
+// so no control is asked for its size. As long as the column count and cell
+// geometry are unchanged, only cells after the unchanged prefix of shown
+// items are placed; on a scrolling card FitScrolled keeps the width, hence
+// the columns, stable.
+void StageCard::LayoutWrapUniform(const Rect& inner) {
     Rect eff = EffectiveContentInset();
-    int insetL = eff.left;
-    int insetR = eff.right;
-    int insetT = eff.top;
-    int insetB = eff.bottom;
+    const int avail_w = max(0, inner.GetWidth()  - eff.left - eff.right);
+    const int inner_h = max(0, inner.GetHeight() - eff.top  - eff.bottom);
+
+    WrapCache& wc = wrapCache;
+    const int cols = max(1, (avail_w + contentGap.cx) / (wrapItem.cx + contentGap.cx));
+    if(wc.cols != cols || wc.inset != eff || wc.gap != contentGap) {
+        wc.cols   = cols;
+        wc.inset  = eff;
+        wc.gap    = contentGap;
+        wc.placed = 0;
+    }
 
-    struct Col {
-        bool spacer;
-        bool is_expand;
-        int  expand;
-        Ctrl* c;
-        int  nat_w;   // natural width of the child
-    };
-    Vector<Col> cols; cols.Reserve(items.GetCount());
+    // Cell k holds the k-th shown item
+    Vector<int>& vis = wc.scratch;
+    vis.SetCount(0);
+    for(int i = 0; i < items.GetCount(); ++i) {
+        const Item& it = items[i];
+        if(it.kind != ItemKind::Spacer && IsItemShown(it))
+            vis.Add(i);
+    }
+    const int n = vis.GetCount();
+    int keep = 0;
+    while(keep < wc.placed && keep < n && keep < wc.idx.GetCount() && wc.idx[keep] == vis[keep])
+        ++keep;
+    Swap(wc.idx, vis);
 
-    const int inner_w = max(0, inner.GetWidth()  - insetL - insetR);
-    const int inner_h = max(0, inner.GetHeight() - insetT - insetB);
+    for(int k = keep; k < n; ++k)
+        Place(*items[wc.idx[k]].c, UniformTileRect(k));
+    wc.placed = n;
 
-    int natural_fixed = 0;
-    int expand_weight = 0;
-    int expand_min    = 0;
-    int expand_count  = 0;
+    const int rows   = (n + cols - 1) / cols;
+    const int used_h = rows > 0 ? rows * (wrapItem.cy + contentGap.cy) - contentGap.cy : 0;
 
-    // Collect columns and measure
-    for(const Item& it : items) {
-        if(it.kind == ItemKind::Spacer) {
-            bool is_exp = (it.expand_w > 0);
-            cols.Add({true, is_exp, max(1, it.expand_w), nullptr, 0});
-            if(is_exp) {
-                expand_weight += max(1, it.expand_w);
-                expand_count++;
-            }
+    virtualLen = max(inner_h, eff.top + used_h + eff.bottom);
+    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+}
+
+void StageCard::GetWrapVisibleRange(int& first, int& last) const {
+    first = last = 0;
+    if(!IsUniformWrap() || wrapCache.cols <= 0)
+        return;
+    const Rect eff   = EffectiveContentInset();
+    const int  row_h = wrapItem.cy + contentGap.cy;
+    const int  page  = contentPane.GetSize().cy;
+    const Vector<int>& cell = wrapCache.idx; // shown items, one per cell
+    const int  n     = cell.GetCount();
+
+    // first row whose bottom is below scroll_y, last row whose top is above the page end
+    const int a  = scroll_y - eff.top - wrapItem.cy;
+    const int r0 = a < 0 ? 0 : a / row_h + 1;
+    const int b  = scroll_y + page - eff.top;
+    if(b <= 0)
+        return;
+    const int r1 = (b + row_h - 1) / row_h - 1;
+
+    const int c0 = min(n, r0 * wrapCache.cols);
+    const int c1 = min(n, (r1 + 1) * wrapCache.cols);
+    first = c0 < n ? cell[c0] : items.GetCount();
+    last  = c1 > c0 ? cell[c1 - 1] + 1 : first;
+}
+
+// -------------------------- Layout (header + content + scrollbars) --------------------------
+// -------------------------- Sticky sections --------------------------
+// Natural header rects, read back after the layout pass placed them.
+void StageCard::CollectSections() {
+    sections.SetCount(0);
+    const bool ragged = IsWrap() && !IsUniformWrap() && !IsJustifiedWrap();
+    if(mode != ContentMode::STACK || (dir != Direction::V && !ragged) || IsVirtual())
+        return;
+    for(int i = 0; i < items.GetCount(); ++i) {
+        const Item& it = items[i];
+        if(!it.section || !IsItemShown(it))
             continue;
+        Section& s = sections.Add();
+        s.c  = it.c;
+        s.rc = it.c->GetRect();
+    }
+}
+
+// Put the pinned header back where the layout left it (rect and z-order),
+// so incremental passes, which skip unmoved tiles, see natural rects only.
+void StageCard::UnpinSection() {
+    if(pinned >= 0 && pinned < sections.GetCount()) {
+        const Section& s = sections[pinned];
+        if(s.c->GetParent() == &contentLayer) {
+            s.c->SetRect(s.rc);
+            if(s.next && s.next->GetParent() == &contentLayer)
+                contentLayer.AddChildBefore(s.c, s.next);
         }
+    }
+    pinned = -1;
+}
 
-        if(!it.c || !it.c->IsShown())
-            continue;
+// Blits what stays in view before the layer moves by (dx, dy): the layer's
+// SetRect matches the blit, so only the strip that scrolled in is repainted.
+// The rounded or framed edge of the content area does not scroll with the
+// rows, so that band is left out of the blit and repainted.
+void StageCard::ScrollContentView(int dx, int dy) {
+    const Size psz = contentPane.GetSize();
+    const ChromeLook& cl = *chrome_;
+    const int edge = max(cl.content.radius, cl.content.IsFramed() ? cl.content.strokeTh : 0);
+    const Point at = contentPane.GetRect().TopLeft();
+    const Rect keep = Rect(psz) & lastContentRc.Offseted(-at.x, -at.y).Deflated(edge, edge);
+    if(keep.IsEmpty()) {
+        contentLayer.Refresh();
+        return;
+    }
+    contentPane.ScrollView(keep, dx, dy);
+    contentPane.Refresh(0, 0, psz.cx, keep.top);
+    contentPane.Refresh(0, keep.bottom, psz.cx, psz.cy - keep.bottom);
+    contentPane.Refresh(0, keep.top, keep.left, keep.GetHeight());
+    contentPane.Refresh(keep.right, keep.top, psz.cx - keep.right, keep.GetHeight());
+}
 
-        Size ms = it.c->GetMinSize();
-        int w = (it.fixed_px >= 0) ? it.fixed_px : ms.cx;
-        bool is_exp = (it.expand_w > 0);
+// Active section = last header whose natural top is at or above scroll_y.
+// It sits at the viewport top, pushed up by the next header. Moving it
+// invalidates its old and new rects, the rest of the pane was blitted.
+void StageCard::SyncSections() {
+    if(sections.IsEmpty())
+        return;
 
-        cols.Add({false, is_exp, it.expand_w, it.c, w});
+    int lo = 0, hi = sections.GetCount();
+    while(lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if(sections[mid].rc.top <= scroll_y) lo = mid + 1;
+        else                                 hi = mid;
+    }
+    const int active = lo - 1;
 
-        if(is_exp) {
-            expand_weight += max(1, it.expand_w);
-            expand_min    = max(expand_min, w);
-            expand_count++;
-        } else {
-            natural_fixed += w;
-        }
+    if(active != pinned) {
+        UnpinSection();
+        if(active < 0)
+            return;
+        pinned = active;
+        Section& a = sections[active];
+        a.next = a.c->GetNext();
+        contentLayer.AddChild(a.c); // topmost, it overlaps the rows it passes
     }
 
-    const int cnt = cols.GetCount();
-    const int total_gaps = (cnt > 0 ? (cnt - 1) * contentGap.cx : 0);
+    const Section& s = sections[active];
+    int y = scroll_y;
+    if(active + 1 < sections.GetCount())
+        y = min(y, sections[active + 1].rc.top - s.rc.GetHeight());
+    y = max(y, s.rc.top);
 
-    int needed = insetL + natural_fixed + insetR + total_gaps;
-    if(expand_count > 0)
-        needed += expand_min * expand_count;
+    const Rect r = RectC(s.rc.left, y, s.rc.GetWidth(), s.rc.GetHeight());
+    if(s.c->GetRect() != r)
+        s.c->SetRect(r);
+}
 
-    const int avail = inner_w;
-    const int extra = max(0, avail - needed);
+// -------------------------- Viewport culling --------------------------
+// Items are bucketed by the horizontal bands of content their rect covers.
+// Layout re-buckets only items whose rect changed; a scroll step only
+// re-tests the items in the bands under the old and the new viewport.
+StageCard& StageCard::EnableContentCulling(bool on) {
+    cullOn = on;
+    if(!on)
+        UncullAll();
+    Relayout();
+    return *this;
+}
 
-    int x = insetL;
-    const int y = insetT;
-    const int h = inner_h;
+bool StageCard::CanCull() const {
+    return cullOn && mode != ContentMode::MANUAL && !IsVirtual()
+           && IsVerticalScroll() && IsScrollShown();
+}
 
-    virtualLen = max(inner_w, needed);
+// Culling takes the control out of the content layer rather than hiding it,
+// so IsShown() stays what the application set, and a Hide() / Show() made
+// while the item is off screen is still in effect when it comes back.
+void StageCard::CullItem(int i, bool out) {
+    Item& it = items[i];
+    if(out == it.culled || !it.c)
+        return;
+    if(out) {
+        if(it.section || !it.c->IsShown() || it.c->HasFocusDeep())
+            return;
+        it.culled = true;
+        ++cullIndex->culled;
+        contentLayer.RemoveChild(it.c);
+    }
+    else
+        cullIndex->enter.Add(i); // put back in item order by AttachEntering()
+}
 
-    for(int i = 0; i < cnt; i++) {
-        int w;
+// Returning controls go back in item order (z-order is Tab order): after the
+// previous item if that one is in the layer, else before the next one, else
+// at the bottom, under a pinned section header.
+void StageCard::AttachEntering() {
+    CullIndex& ci = *cullIndex;
+    auto Attached = [&](int k) -> Ctrl * {
+        if(k < 0 || k >= items.GetCount())
+            return nullptr;
+        const Item& q = items[k];
+        return q.c && !q.section && !q.culled && q.c->GetParent() == &contentLayer ? q.c : nullptr;
+    };
+    Sort(ci.enter);
+    for(int i : ci.enter) {
+        Item& it = items[i];
+        if(!it.culled)
+            continue; // listed by more than one band
+        it.culled = false;
+        --ci.culled;
+        if(it.c->GetParent())
+            continue; // the application moved it meanwhile
+        if(Ctrl *prev = Attached(i - 1))
+            contentLayer.AddChild(it.c, prev);
+        else if(Ctrl *next = Attached(i + 1))
+            contentLayer.AddChildBefore(it.c, next);
+        else if(Ctrl *first = contentLayer.GetFirstChild())
+            contentLayer.AddChildBefore(it.c, first);
+        else
+            contentLayer.AddChild(it.c);
+    }
+    ci.enter.SetCount(0);
+}
 
-        if(cols[i].is_expand && expand_weight > 0) {
-            int share = (extra * cols[i].expand) / expand_weight;
-            w = expand_min + share;
-        } else {
-            w = cols[i].nat_w;
-        }
+void StageCard::UncullAll() {
+    if(!cullIndex)
+        return;
+    for(int i = 0; i < items.GetCount(); ++i)
+        CullItem(i, false);
+    AttachEntering();
+    cullIndex->culled = 0; // items dropped while culled are not in `items` any more
+    cullIndex->view = Null;
+}
+
+void StageCard::UnindexItem(int i) {
+    CullIndex& ci = *cullIndex;
+    const Rect& r = ci.at[i];
+    if(IsNull(r))
+        return;
+    const int b1 = min(r.bottom / ci.band, ci.cells.GetCount() - 1);
+    for(int b = max(0, r.top / ci.band); b <= b1; ++b) {
+        Vector<int>& cell = ci.cells[b];
+        for(int k = 0; k < cell.GetCount(); ++k)
+            if(cell[k] == i) {
+                cell[k] = cell.Top(); // order within a band does not matter
+                cell.Drop();
+                break;
+            }
+    }
+    ci.at[i] = Null;
+}
 
-        if(!cols[i].spacer && cols[i].c)
-            cols[i].c->SetRect(Rect(x, y, x + w, y + h));
+void StageCard::IndexItem(int i, const Rect& r) {
+    CullIndex& ci = *cullIndex;
+    const int b0 = max(0, r.top / ci.band);
+    const int b1 = max(b0, r.bottom / ci.band);
+    if(ci.cells.GetCount() <= b1)
+        ci.cells.SetCount(b1 + 1);
+    for(int b = b0; b <= b1; ++b)
+        ci.cells[b].Add(i);
+    ci.at[i] = r;
+}
 
-        x += w;
-        if(i + 1 < cnt)
-            x += contentGap.cx;
+void StageCard::CullBands(int top, int bottom, const Rect& view) {
+    CullIndex& ci = *cullIndex;
+    const int b1 = min(bottom / ci.band, ci.cells.GetCount() - 1);
+    for(int b = max(0, top / ci.band); b <= b1; ++b)
+        for(int i : ci.cells[b])
+            CullItem(i, !ci.at[i].Intersects(view));
+}
+
+// Only items appended since the last pass and items CommitGeometry moved
+// are (re)bucketed; an index reset re-buckets everything once.
+void StageCard::SyncCulling() {
+    if(!CanCull()) {
+        if(cullIndex) {
+            if(cullIndex->culled || !IsNull(cullIndex->view))
+                UncullAll();
+            cullIndex->moved.SetCount(0);
+        }
+        return;
+    }
+    if(!cullIndex)
+        cullIndex.Create(); // first pass with the content overflowing
+    CullIndex& ci = *cullIndex;
+
+    const Size page = contentPane.GetSize();
+    const Rect view = RectC(0, scroll_y, contentLayer.GetSize().cx, page.cy);
+    const int  n = items.GetCount();
+    if(ci.at.GetCount() > n)
+        ci.Clear();
+    const bool fresh = IsNull(ci.view);
+
+    const int old_n = ci.at.GetCount();
+    ci.at.SetCount(n, Null);
+    for(int i = old_n; i < n; ++i) {
+        Item& it = items[i];
+        ci.ctrl.Add(it.c);
+        if(!it.c)
+            continue;
+        IndexItem(i, it.c->GetRect());
+        if(!fresh)
+            CullItem(i, !ci.at[i].Intersects(view));
+    }
+    for(Ctrl *c : ci.moved) {
+        const int i = ci.ctrl.Find(c);
+        if(i < 0 || i >= old_n)
+            continue; // not an item, or indexed above
+        const Rect r = c->GetRect();
+        if(ci.at[i] == r)
+            continue;
+        UnindexItem(i);
+        IndexItem(i, r);
+        if(!fresh)
+            CullItem(i, !r.Intersects(view));
     }
+    ci.moved.SetCount(0);
+
+    if(fresh) { // first pass: every item gets a verdict once
+        for(int i = 0; i < n; ++i)
+            if(items[i].c && !IsNull(ci.at[i]))
+                CullItem(i, !ci.at[i].Intersects(view));
+    } else if(ci.view != view) {
+        CullBands(ci.view.top, ci.view.bottom, view); // leaving the viewport
+        CullBands(view.top, view.bottom, view);       // entering it
+    }
+    AttachEntering();
+    ci.view = view;
+}
 
-    contentLayer.SetRect(-scroll_y, 0, virtualLen, inner.GetHeight());
+// -------------------------- Thrash detector (debug) --------------------------
+#ifdef _DEBUG
+static int sThrashLayouts = 8;
+static int sThrashPaints  = 4;
+
+void StageCard::SetThrashBudget(int layouts, int paints) {
+    sThrashLayouts = max(1, layouts);
+    sThrashPaints  = max(1, paints);
 }
 
+// The first call of an iteration posts the flush, which runs once the
+// event loop is back to idle.
+void StageCard::ThrashCount(bool paint) const {
+    ThrashMeter& m = thrash;
+    if(!m.armed) {
+        m.armed = true;
+        m.tick.KillPost([this] { ThrashFlush(); });
+    }
+    if(paint)
+        ++m.stats.paints;
+    else {
+        ++m.stats.layouts;
+        ++m.by.GetAdd(m.setter ? m.setter : "Layout", 0);
+    }
+}
 
-void StageCard::LayoutWrapH(const Rect& inner) {
-    Rect eff = EffectiveContentInset();
-    int insetL = eff.left;
-    int insetR = eff.right;
-    int insetT = eff.top;
-    int insetB = eff.bottom;
+void StageCard::ThrashFlush() const {
+    ThrashMeter& m  = thrash;
+    ThrashStats& st = m.stats;
+    String setters;
+    for(int i = 0; i < m.by.GetCount(); ++i)
+        setters << (i ? ", " : "") << m.by.GetKey(i) << " x" << m.by[i];
+    if(st.layouts > st.peakLayouts) {
+        st.peakLayouts = st.layouts;
+        st.peakSetters = setters;
+    }
+    st.peakPaints = max(st.peakPaints, st.paints);
+    if(st.layouts > sThrashLayouts || st.paints > sThrashPaints)
+        LOG("StageCard \"" << title << "\": " << st.layouts << " Layout(), " << st.paints
+            << " Paint() in one event-loop iteration [" << setters << "]");
+    st.layouts = st.paints = 0;
+    m.by.Clear();
+    m.armed = false;
+}
+#endif
+
+// -------------------------- Layout scratch / stats --------------------------
+// Bytes reserved by every buffer a layout pass may grow: scratch, mode
+// caches, staged geometry, memos, sticky sections, culling, virtual and
+// painted geometry (and the shared StageLayoutMemo when the card uses it).
+// A same-size relayout must leave it unchanged; anything else means the
+// heap was touched. Map and index keys grow with their value / rect arrays,
+// so those stand for them.
+int64 StageCard::ScratchFootprint() const {
+    auto ints = [](std::initializer_list<const Vector<int> *> l) {
+        int64 n = 0;
+        for(const Vector<int> *v : l)
+            n += (int64)v->GetAlloc() * sizeof(int);
+        return n;
+    };
+    const LayoutScratch& ls = scratch;
+    int64 n = (int64)ls.stackCtrl.GetAlloc() * sizeof(Ctrl *)
+            + (int64)ls.geom.rects.GetAlloc() * sizeof(Rect)
+            + (int64)(ls.stack.GetAlloc() + wrapCache.specs.GetAlloc()) * (3 * sizeof(int) + 1)
+            + (int64)ls.rebuilt.GetAlloc() * sizeof(Item)
+            + wrapCache.solver.GetAlloc()
+            + ls.taken.GetAlloc();
+    n += ints({ &ls.vis, &ls.col, &ls.colspan, &ls.row, &ls.rowspan, &ls.natw, &ls.nath,
+                &ls.colPos, &ls.colSize, &ls.rowPos, &ls.rowSize,
+                &wrapCache.idx, &wrapCache.scratch, &wrapCache.changed });
+    n += (int64)items.GetAlloc() * sizeof(Item);
+    n += (int64)staged.GetValues().GetAlloc() * (sizeof(Ctrl *) + sizeof(Rect))
+       + (int64)hfwMemo.GetAlloc() * sizeof(Size)
+       + (int64)sections.GetAlloc() * sizeof(Section)
+       + (int64)deferredKids.GetAlloc() * sizeof(StageCard *);
+    // per-mode blocks count once created
+    if(justifyCache) {
+        const JustifyCache& jc = *justifyCache;
+        n += sizeof(JustifyCache) + ints({ &jc.idx, &jc.scratch });
+        for(int i = 0; i < jc.memo.GetCount(); ++i)
+            n += sizeof(JustifyLayout) + (int64)jc.memo[i].rects.GetAlloc() * sizeof(Rect);
+    }
+    if(masonryCache) {
+        const MasonryCache& mc = *masonryCache;
+        n += sizeof(MasonryCache) + ints({ &mc.idx, &mc.bottom, &mc.heap, &mc.scratch });
+    }
+    if(cullIndex) {
+        const CullIndex& ci = *cullIndex;
+        n += sizeof(CullIndex) + ints({ &ci.enter })
+           + (int64)ci.cells.GetAlloc() * sizeof(Vector<int>)
+           + (int64)ci.at.GetAlloc() * (sizeof(Rect) + sizeof(Ctrl *))
+           + (int64)ci.moved.GetAlloc() * sizeof(Ctrl *);
+        for(const Vector<int>& cell : ci.cells)
+            n += (int64)cell.GetAlloc() * sizeof(int);
+    }
+    if(virt) {
+        const VirtualState& v = *virt;
+        n += sizeof(VirtualState)
+           + ints({ &v.rowH, &v.tree.t, &v.prefix, &v.bound, &v.slotOf, &v.spare })
+           + v.rowKnown.GetAlloc()
+           + (int64)v.sizes.GetAlloc() * sizeof(Size)
+           + (int64)v.lines.GetAlloc() * sizeof(WrapLine);
+    }
+    if(painted)
+        n += sizeof(PaintedState) + ints({ &painted->visible }) + painted->index.GetAlloc();
+    if(layoutMemo)
+        n += StageLayoutMemo::GetAlloc();
+    return n;
+}
 
-    const int avail_w = max(0, inner.GetWidth()  - insetL - insetR);
-    const int inner_h = max(0, inner.GetHeight() - insetT - insetB);
+// Text extents are remembered per (text, font); the header only re-measures
+// when one of them changes.
+Size StageCard::TextExtent::Get(const String& s, Font f, LayoutStats& st) {
+    if(IsNull(size) || s != text || f != font) {
+        text = s;
+        font = f;
+        size = GetTextSize(s, f);
+        ++st.measures;
+    }
+    return size;
+}
 
-    int x = insetL;
-    int y = insetT;
-    int line_h = 0;
+// -------------------------- Geometry commit --------------------------
+// Layout passes only stage child rects; a mode may run twice (without and
+// with the scrollbar), the last rect staged for a control wins.
+void StageCard::Place(Ctrl& c, const Rect& r) {
+    staged.GetAdd(&c) = r;
+    ++layoutStats.placed;
+}
 
-    for(Item& it : items) {
-        if(it.kind == ItemKind::Spacer) continue;
-        if(!it.c || !it.c->IsShown())   continue;
+// Apply staged rects that differ from the current ones. Unmoved children
+// get no SetRect (so no Layout() of their own) and no invalidation; the
+// content layer repaints only the union of old and new rects of the rest.
+void StageCard::CommitGeometry() {
+    Rect dirty = Null;
+    for(int i = 0; i < staged.GetCount(); ++i) {
+        Ctrl *c = staged.GetKey(i);
+        const Rect& r = staged[i];
+        const Rect  o = c->GetRect();
+        if(o == r)
+            continue;
+        dirty = IsNull(dirty) ? (o | r) : (dirty | o | r);
+        c->SetRect(r);
+        if(cullIndex)
+            cullIndex->moved.Add(c); // SyncCulling re-buckets only these
+    }
+    staged.Trim(0); // keeps its buffers for the next pass
+    if(!IsNull(dirty))
+        contentLayer.Refresh(dirty);
+}
 
-        const Size ms = it.c->GetMinSize();
-        const int cw  = (it.fixed_w >= 0 ? it.fixed_w : ms.cx);
-        const int ch  = (it.fixed_h >= 0 ? it.fixed_h : ms.cy);
+// Everything Paint() draws outside the children: when none of it changed,
+// Layout() does not invalidate the card.
+dword StageCard::ChromeHash() const {
+    CombineHash h;
+    h << GetSize() << lastHeaderRc << lastContentRc << lastVBarRc << badgeIconRc
+      << title << subTitle << badge
+      << titleX << titleY << titleW << subTitleX << subTitleY << subTitleW
+      << titleLineY << line1X << line1W << line2X << line2W
+      << vLineX << vLineY << vLineH << underlineVertical << Metrics().titleUnderlineTh
+      << Metrics().titleFont << Metrics().subTitleFont << Metrics().badgeFont
+      << hasBadgeIcon << badgeIcon.GetSerialId();
+    return h;
+}
 
-        int nx = (x == insetL) ? x : x + contentGap.cx;
+// Top-down half of the tree pass: every child card placed during our
+// Layout() now lays out exactly once, with the rect it ended up with.
+void StageCard::FlushDeferredLayouts() {
+    for(int i = 0; i < deferredKids.GetCount(); ++i) { // kids never add to our list
+        StageCard *kid = deferredKids[i];
+        kid->layoutDeferred = false;
+        if(kid->ParentCard() == this)
+            kid->Layout();
+    }
+    deferredKids.SetCount(0);
+}
 
-        if(nx + cw > insetL + avail_w && x != insetL) {
-            x = insetL;
-            y += line_h + contentGap.cy;
-            line_h = 0;
-            nx = x;
+// -------------------------- Height for width --------------------------
+// Card rect -> content inner rect margins, as Layout() computes them.
+Rect StageCard::ChromeMargins() const {
+    const int card_pad    = chrome_->card.Pad();
+    const int content_pad = chrome_->content.Pad();
+    const int header_h = max(cachedHeaderMin, HeaderHeight());
+    const int side = card_pad + content_pad;
+    return Rect(side + contentInset.left,
+                side + header_h + cardGap + contentInset.top,
+                side + contentInset.right,
+                side + contentInset.bottom);
+}
+
+int StageCard::GetHeightForWidth(int width) const {
+    for(int i = 0; i < hfwMemo.GetCount(); ++i)
+        if(hfwMemo[i].cx == width) {
+            const Size hit = hfwMemo[i];
+            hfwMemo.Remove(i);
+            hfwMemo.Insert(0, hit);
+            return hit.cy;
         }
 
-        it.c->SetRect(Rect(nx, y, nx + cw, y + ch));
-        x = nx + cw;
-        line_h = max(line_h, ch);
+    const Rect m = ChromeMargins();
+    const int h = m.top + MeasureNaturalPrimaryForWidth(max(0, width - m.left - m.right)) + m.bottom;
+
+    if(hfwMemo.GetCount() >= HFW_MEMO)
+        hfwMemo.Drop();
+    hfwMemo.Insert(0, Size(width, h));
+    return h;
+}
+
+StageCard* StageCard::ParentCard() const {
+    Ctrl *layer = GetParent();
+    Ctrl *pane  = layer ? layer->GetParent() : nullptr;
+    StageCard *card = pane ? dynamic_cast<StageCard *>(pane->GetParent()) : nullptr;
+    return card && layer == &card->contentLayer ? card : nullptr;
+}
+
+// Natural-size STACKV rows holding a card take their height from the card
+bool StageCard::UsesHeightForWidth(const Item& it) const {
+    return mode == ContentMode::STACK && dir == Direction::V && !IsVirtual()
+           && it.kind == ItemKind::CtrlItem && it.fixed_px < 0 && !it.section
+           && dynamic_cast<const StageCard *>(it.c);
+}
+
+// Our height-for-width may have changed: drop the memo and tell the parent
+// card. Changes made inside Layout() are reported once it is done.
+void StageCard::ContentChanged() {
+    hfwMemo.Clear();
+    if(inLayout || batch) {
+        notifyPending = true;
+        return;
     }
+    if(StageCard *p = ParentCard())
+        p->ChildSizeChanged(*this);
+}
 
-    const int used_h = (x == insetL ? y : y + line_h);
-    const int needed = used_h + insetB;
+// Content changed: tell the parent card, then lay out unless its pass (we
+// sit in a height-for-width row) already laid us out with the new content.
+bool StageCard::ContentChangedLaidOut() {
+    const int64 n = layoutStats.layouts;
+    ContentChanged();
+    return layoutStats.layouts != n;
+}
 
-    virtualLen = max(inner_h, needed);
-    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+// Only a parent whose row height follows the child relayouts, and only
+// then does the notification travel further up.
+void StageCard::ChildSizeChanged(StageCard& child) {
+    for(const Item& it : items)
+        if(it.c == &child) {
+            if(UsesHeightForWidth(it))
+                Reflow();
+            return;
+        }
 }
 
-// -------------------------- Layout (header + content + scrollbars) --------------------------
 StageCard& StageCard::SetHeaderColor(Color face_base, Color border_base) {
-    MakeFaceStates(face_base,   palette_.headerFace);
-    MakeBorderStates(border_base, palette_.headerBorder);
+    UiPalette& pal = OwnPalette();
+    MakeFaceStates(face_base,   pal.headerFace);
+    MakeBorderStates(border_base, pal.headerBorder);
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetHeaderColorState(Color fN, Color fH, Color fP, Color fD,
                                           Color bN, Color bH, Color bP, Color bD) {
-    palette_.headerFace[0]=fN; palette_.headerFace[1]=fH; palette_.headerFace[2]=fP; palette_.headerFace[3]=fD;
-    palette_.headerBorder[0]=bN; palette_.headerBorder[1]=bH; palette_.headerBorder[2]=bP; palette_.headerBorder[3]=bD;
+    UiPalette& pal = OwnPalette();
+    pal.headerFace[0]=fN; pal.headerFace[1]=fH; pal.headerFace[2]=fP; pal.headerFace[3]=fD;
+    pal.headerBorder[0]=bN; pal.headerBorder[1]=bH; pal.headerBorder[2]=bP; pal.headerBorder[3]=bD;
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetTitleColor(Color base, Color disabled) {
-    palette_.titleInk[0]=base; palette_.titleInk[1]=base; palette_.titleInk[2]=base; palette_.titleInk[3]=disabled;
+    UiPalette& pal = OwnPalette();
+    pal.titleInk[0]=base; pal.titleInk[1]=base; pal.titleInk[2]=base; pal.titleInk[3]=disabled;
     Refresh();
     return *this;
 }
 StageCard& StageCard::SetSubTitleColor(Color base, Color disabled) {
-    palette_.subTitleInk[0]=base; palette_.subTitleInk[1]=base; palette_.subTitleInk[2]=base; palette_.subTitleInk[3]=disabled;
+    UiPalette& pal = OwnPalette();
+    pal.subTitleInk[0]=base; pal.subTitleInk[1]=base; pal.subTitleInk[2]=base; pal.subTitleInk[3]=disabled;
     Refresh();
     return *this;
 }
 StageCard& StageCard::SetBadgeColor(Color base, Color disabled) {
-    palette_.badgeInk[0]=base; palette_.badgeInk[1]=base; palette_.badgeInk[2]=base; palette_.badgeInk[3]=disabled;
+    UiPalette& pal = OwnPalette();
+    pal.badgeInk[0]=base; pal.badgeInk[1]=base; pal.badgeInk[2]=base; pal.badgeInk[3]=disabled;
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetTitleColorState(Color n, Color h, Color p, Color d) {
-    palette_.titleInk[0]=n; palette_.titleInk[1]=h; palette_.titleInk[2]=p; palette_.titleInk[3]=d;
+    UiPalette& pal = OwnPalette();
+    pal.titleInk[0]=n; pal.titleInk[1]=h; pal.titleInk[2]=p; pal.titleInk[3]=d;
     Refresh(); return *this;
 }
 StageCard& StageCard::SetSubTitleColorState(Color n, Color h, Color p, Color d) {
-    palette_.subTitleInk[0]=n; palette_.subTitleInk[1]=h; palette_.subTitleInk[2]=p; palette_.subTitleInk[3]=d;
+    UiPalette& pal = OwnPalette();
+    pal.subTitleInk[0]=n; pal.subTitleInk[1]=h; pal.subTitleInk[2]=p; pal.subTitleInk[3]=d;
     Refresh(); return *this;
 }
 StageCard& StageCard::SetBadgeColorState(Color n, Color h, Color p, Color d) {
-    palette_.badgeInk[0]=n; palette_.badgeInk[1]=h; palette_.badgeInk[2]=p; palette_.badgeInk[3]=d;
+    UiPalette& pal = OwnPalette();
+    pal.badgeInk[0]=n; pal.badgeInk[1]=h; pal.badgeInk[2]=p; pal.badgeInk[3]=d;
     Refresh(); return *this;
 }
 
 StageCard& StageCard::SetContentColor(Color bg, Color ink) {
-    palette_.contentBg = bg;
-    palette_.contentInk = ink;
+    UiPalette& pal = OwnPalette();
+    pal.contentBg = bg;
+    pal.contentInk = ink;
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetCardColors(Color fill, Color stroke) {
-    palette_.cardFill = fill;
-    palette_.cardBorder = stroke;
+    UiPalette& pal = OwnPalette();
+    pal.cardFill = fill;
+    pal.cardBorder = stroke;
     Refresh();
     return *this;
 }
 
 StageCard& StageCard::SetHeaderInset(int l, int t, int r, int b) {
     headerInset = Rect(max(0,l), max(0,t), max(0,r), max(0,b));
-    Layout();
+    Relayout();
     return *this;
 }
 StageCard& StageCard::SetHeaderGap(int px) {
-    metrics_.headerGap = max(0, px);
-    Layout();
+    OwnMetrics().headerGap = max(0, px);
+    Relayout();
     return *this;
 }
 StageCard& StageCard::SetCardGap(int px) {
     cardGap = max(0, px);
-    Layout();
+    Relayout();
     return *this;
 }
 
 StageCard& StageCard::SetContentInset(int l, int t, int r, int b) {
     contentInset = Rect(max(0,l), max(0,t), max(0,r), max(0,b));
-    Layout();
+    Reflow();
     return *this;
 }
 StageCard& StageCard::SetContentInnerInset(int l, int t, int r, int b) {
     contentInnerInset = Rect(max(0,l), max(0,t), max(0,r), max(0,b));
-    Layout();
+    Reflow();
     return *this;
 }
 StageCard& StageCard::SetContentGap(int gx, int gy) {
     contentGap = Size(max(0,gx), max(0,gy));
-    Layout();
+    Reflow();
     return *this;
 }
 
 void StageCard::Layout() {
+    Rect frame_rc, inner;
+    if(LayoutChrome(frame_rc, inner)) {
+        LayoutContent(inner);
+        FinishLayout(frame_rc);
+    }
+}
+
+// Header band and content frame; false when the pass is deferred to the
+// parent card.
+bool StageCard::LayoutChrome(Rect& frame_rc, Rect& inner) {
+    if(batch)
+        return false; // the batch lays out once when it ends
+    // Placed by a parent card mid-pass: lay out once, when its pass ends
+    if(StageCard *p = ParentCard())
+        if(p->inLayout) {
+            if(!layoutDeferred) {
+                layoutDeferred = true;
+                p->deferredKids.Add(this);
+            }
+            return false;
+        }
+#ifdef _DEBUG
+    ThrashCount(false); // only passes that run
+#endif
+
     const Size sz = GetSize();
+    inLayout = true;
+    ++layoutStats.layouts;
+    layoutFootprint = ScratchFootprint();
+    UnpinSection();
 
     // Outer card rect (inside card frame)
     Rect outer = Rect(sz);
-    if(cardFrameOn && cardStrokeTh > 0) {
-        int pad = (cardStrokeTh + 1) / 2;
-        if(cardRadius > 0)
-            pad += max(1, cardRadius / 4);
+    if(int pad = chrome_->card.Pad()) {
         outer = outer.Deflated(pad, pad);
         if(outer.right < outer.left)  outer.right  = outer.left;
         if(outer.bottom < outer.top)  outer.bottom = outer.top;
@@ -753,7 +2364,7 @@ void StageCard::Layout() {
     const int inner_left   = outer.left  + headerInset.left;
     const int inner_right  = outer.right - headerInset.right;
     const int inner_width  = max(0, inner_right - inner_left);
-    const int icon_band_h  = max(0, headerInset.top - metrics_.headerGap);
+    const int icon_band_h  = max(0, headerInset.top - Metrics().headerGap);
     const int cx           = inner_left + inner_width / 2;
 
     badgeIconRc = RectC(0,0,0,0);
@@ -812,7 +2423,7 @@ void StageCard::Layout() {
     int subTitleH = 0;
 
     if(!IsNull(title)) {
-        Size ts = GetTextSize(title, metrics_.titleFont);
+        Size ts = titleExt.Get(title, Metrics().titleFont, layoutStats);
         titleW = ts.cx;
         titleH = ts.cy;
 
@@ -824,8 +2435,8 @@ void StageCard::Layout() {
         textTop = titleY;
         y += ts.cy;
 
-        if(metrics_.titleUnderlineTh > 0 && !underlineVertical) {
-            y += metrics_.headerGap;
+        if(Metrics().titleUnderlineTh > 0 && !underlineVertical) {
+            y += Metrics().headerGap;
             const int lineY = y;
             if(effBadgeAlign == CENTER && badgeIconRc.GetWidth() > 0) {
                 int left_end  = min(textR, badgeIconRc.left - badgeGapX/2);
@@ -836,15 +2447,15 @@ void StageCard::Layout() {
                 line1X = textL; line1W = textW; line2X = line2W = 0;
             }
             titleLineY = lineY;
-            y += metrics_.titleUnderlineTh;
+            y += Metrics().titleUnderlineTh;
         }
 
-        y += metrics_.headerGap;
+        y += Metrics().headerGap;
     }
 
     subTitleX = subTitleY = subTitleW = 0;
     if(!IsNull(subTitle)) {
-        Size ss = GetTextSize(subTitle, metrics_.subTitleFont);
+        Size ss = subTitleExt.Get(subTitle, Metrics().subTitleFont, layoutStats);
         subTitleH = ss.cy;
         if(headerAlign == LEFT)       subTitleX = textL;
         else if(headerAlign == RIGHT) subTitleX = max(textL, textR - ss.cx);
@@ -852,7 +2463,7 @@ void StageCard::Layout() {
         subTitleY = y;
         subTitleW = ss.cx;
         y += ss.cy;
-        y += metrics_.headerGap;
+        y += Metrics().headerGap;
     }
 
     if(!IsNull(title)) {
@@ -861,8 +2472,8 @@ void StageCard::Layout() {
         else
             textBottom = titleY + titleH;
 
-        if(underlineVertical && metrics_.titleUnderlineTh > 0) {
-            int gap = metrics_.padX;
+        if(underlineVertical && Metrics().titleUnderlineTh > 0) {
+            int gap = Metrics().padX;
             int baseX;
 
             if(headerAlign == RIGHT)
@@ -880,16 +2491,19 @@ void StageCard::Layout() {
     }
 
     int header_child_bottom = 0;
-    for(Ctrl *q = headerPane.GetFirstChild(); q; q = q->GetNext())
+    for(Ctrl *q = headerPane ? headerPane->GetFirstChild() : nullptr; q; q = q->GetNext())
         header_child_bottom = max(header_child_bottom, q->GetRect().bottom);
 
     int header_h_text = y - outer.top + headerInset.bottom;
     const int header_h = max(header_h_text,
                              headerInset.top + header_child_bottom + headerInset.bottom);
+    if(cachedHeaderMin != max(header_h, DPI(10)))
+        ContentChanged(); // header band is part of GetHeightForWidth
     cachedHeaderMin = max(header_h, DPI(10));
 
     lastHeaderRc = Rect(outer.left, outer.top, outer.right, outer.top + header_h);
-    headerPane.SetRect(lastHeaderRc);
+    if(headerPane)
+        headerPane->SetRect(lastHeaderRc);
 
     // --- Content viewport (between header and bottom of card) ---
     Rect pane_rc = Rect(outer.left,
@@ -921,156 +2535,101 @@ void StageCard::Layout() {
     }
 
     // Split: frame rect vs inner content rect
-    Rect frame_rc = pane_rc;           // used for content frame drawing
-    Rect inner    = frame_rc;          // used for contentPane / children
+    frame_rc = pane_rc;                // used for content frame drawing
+    inner    = frame_rc;               // used for contentPane / children
 
-    if(contentFrameOn && contentStrokeTh > 0) {
-        int pad = (contentStrokeTh + 1) / 2;
-        if(contentRadius > 0)
-            pad += max(1, contentRadius / 4);
+    if(int pad = chrome_->content.Pad()) {
         inner = inner.Deflated(pad, pad);
         if(inner.right < inner.left)   inner.right  = inner.left;
         if(inner.bottom < inner.top)   inner.bottom = inner.top;
     }
 
-    const int sbw = DPI(14);
+    return true;
+}
+
+// Runtime mode dispatch; StageCardT<Policy> resolves the same branches at
+// compile time in LayoutContentAs().
+void StageCard::LayoutContent(Rect inner) {
+    BeginContent(inner);
+    if(mode == ContentMode::STACK) {
+        if(dir == Direction::V)
+            FitScrolled<true>(inner, false, [&](const Rect& r) { LayoutStackV(r); });
+        else if(wrap)
+            FitScrolled<true>(inner, false, [&](const Rect& r) { LayoutWrapH(r); });
+        else
+            FitScrolled<true>(inner, true,  [&](const Rect& r) { LayoutStackH(r); });
+    }
+    else if(mode == ContentMode::GRID)
+        FitScrolled<true>(inner, false, [&](const Rect& r) { LayoutGrid(r); });
+    else if(mode == ContentMode::MASONRY)
+        FitScrolled<true>(inner, false, [&](const Rect& r) { LayoutMasonry(r); });
+    else
+        LayoutManual<true>(inner, dir == Direction::V);
+}
+
+void StageCard::BeginContent(const Rect& inner) {
     contentPane.SetRect(inner);
     RebuildItemsFromChildrenIfNeeded();
-
     lastVBarRc = RectC(0,0,0,0);
+}
 
-    if(mode == ContentMode::STACK) {
-        if(dir == Direction::V) {
-            LayoutStackV(inner);
-            bool overflow = (virtualLen > inner.GetHeight());
-            bool show_sb  = scrollEnabled && overflow;
-            if(show_sb) {
-                contentPane.SetRect(inner.left, inner.top,
-                                    inner.GetWidth()-sbw, inner.GetHeight());
-                inner = contentPane.GetRect();
-                LayoutStackV(inner);
-            }
-            if(scrollEnabled && (virtualLen > inner.GetHeight())) {
-                vbar.Show();
-                vbar.LeftPos(inner.right, sbw).TopPos(inner.top, inner.GetHeight());
-                vbar.SetTotal(virtualLen);
-                vbar.SetPage(inner.GetHeight());
-                const int maxpos = max(0, virtualLen - inner.GetHeight());
-                scroll_y = clamp(scroll_y, 0, maxpos);
-                vbar.Set(scroll_y);
-                lastVBarRc = Rect(inner.right, inner.top,
-                                  inner.right + sbw, inner.top + inner.GetHeight());
-            } else {
-                vbar.Hide(); scroll_y = 0; lastVBarRc = RectC(0,0,0,0);
-            }
-        } else {
-            if(wrap) {
-                LayoutWrapH(inner);
-                bool overflow = (virtualLen > inner.GetHeight());
-                bool show_sb  = scrollEnabled && overflow;
-                if(show_sb) {
-                    contentPane.SetRect(inner.left, inner.top,
-                                        inner.GetWidth()-sbw, inner.GetHeight());
-                    inner = contentPane.GetRect();
-                    LayoutWrapH(inner);
-                }
-                if(scrollEnabled && (virtualLen > inner.GetHeight())) {
-                    vbar.Show();
-                    vbar.LeftPos(inner.right, sbw).TopPos(inner.top, inner.GetHeight());
-                    vbar.SetTotal(virtualLen);
-                    vbar.SetPage(inner.GetHeight());
-                    const int maxpos = max(0, virtualLen - inner.GetHeight());
-                    scroll_y = clamp(scroll_y, 0, maxpos);
-                    vbar.Set(scroll_y);
-                    lastVBarRc = Rect(inner.right, inner.top,
-                                      inner.right + sbw, inner.top + inner.GetHeight());
-                } else {
-                    vbar.Hide(); scroll_y = 0; lastVBarRc = RectC(0,0,0,0);
-                }
-            } else {
-                LayoutStackH(inner);
-                bool overflow = (virtualLen > inner.GetWidth());
-                bool show_sb  = scrollEnabled && overflow;
-                if(show_sb) {
-                    contentPane.SetRect(inner.left, inner.top,
-                                        inner.GetWidth()-sbw, inner.GetHeight());
-                    inner = contentPane.GetRect();
-                    LayoutStackH(inner);
-                }
-                if(scrollEnabled && (virtualLen > inner.GetWidth())) {
-                    vbar.Show();
-                    vbar.LeftPos(inner.right, sbw).TopPos(inner.top, inner.GetHeight());
-                    vbar.SetTotal(virtualLen);
-                    vbar.SetPage(inner.GetWidth());
-                    const int maxpos = max(0, virtualLen - inner.GetWidth());
-                    scroll_y = clamp(scroll_y, 0, maxpos);
-                    vbar.Set(scroll_y);
-                    lastVBarRc = Rect(inner.right, inner.top,
-                                      inner.right + sbw, inner.top + inner.GetHeight());
-                } else {
-                    vbar.Hide(); scroll_y = 0; lastVBarRc = RectC(0,0,0,0);
-                }
-            }
-        }
-    } else { // MANUAL
-        Rect bounds(0,0,0,0);
-        for(Ctrl* q = contentLayer.GetFirstChild(); q; q = q->GetNext())
-            if(q->IsShown()) bounds |= q->GetRect();
+// Union of the children placed by hand, plus the trailing inset
+int StageCard::ManualContentLen(bool vertical) const {
+    Rect bounds(0,0,0,0);
+    for(Ctrl* q = contentLayer.GetFirstChild(); q; q = q->GetNext())
+        if(q->IsShown()) bounds |= q->GetRect();
+    const Rect eff = EffectiveContentInset();
+    return vertical ? bounds.bottom + eff.bottom : bounds.right + eff.right;
+}
 
-        Rect eff = EffectiveContentInset();
-        int insetB = eff.bottom;
-        int insetR = eff.right;
+// Scrollbar in the slot right of `inner`; page is the viewport length along
+// the scroll axis.
+void StageCard::ShowScrollBar(const Rect& inner, int page) {
+    const int sbw = DPI(14);
+    ScrollBar& sb = VBar();
+    sb.Show();
+    sb.LeftPos(inner.right, sbw).TopPos(inner.top, inner.GetHeight());
+    sb.SetTotal(virtualLen);
+    sb.SetPage(page);
+    scroll_y = clamp(scroll_y, 0, max(0, virtualLen - page));
+    sb.Set(scroll_y);
+    lastVBarRc = Rect(inner.right, inner.top, inner.right + sbw, inner.bottom);
+}
 
-        if(dir == Direction::V) {
-            virtualLen = max(inner.GetHeight(), bounds.bottom + insetB);
-            contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
-            bool overflow = (virtualLen > inner.GetHeight());
-            bool show_sb  = scrollEnabled && overflow;
-            if(show_sb) {
-                contentPane.SetRect(inner.left, inner.top,
-                                    inner.GetWidth()-sbw, inner.GetHeight());
-                inner = contentPane.GetRect();
-                contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
-                vbar.Show();
-                vbar.LeftPos(inner.right, sbw).TopPos(inner.top, inner.GetHeight());
-                vbar.SetTotal(virtualLen);
-                vbar.SetPage(inner.GetHeight());
-                const int maxpos = max(0, virtualLen - inner.GetHeight());
-                scroll_y = clamp(scroll_y, 0, maxpos);
-                vbar.Set(scroll_y);
-                lastVBarRc = Rect(inner.right, inner.top,
-                                  inner.right + sbw, inner.top + inner.GetHeight());
-            } else {
-                vbar.Hide(); scroll_y = 0; lastVBarRc = RectC(0,0,0,0);
-            }
-        } else {
-            virtualLen = max(inner.GetWidth(), bounds.right + insetR);
-            contentLayer.SetRect(-scroll_y, 0, virtualLen, inner.GetHeight());
-            bool overflow = (virtualLen > inner.GetWidth());
-            bool show_sb  = scrollEnabled && overflow;
-            if(show_sb) {
-                contentPane.SetRect(inner.left, inner.top,
-                                    inner.GetWidth()-sbw, inner.GetHeight());
-                inner = contentPane.GetRect();
-                contentLayer.SetRect(-scroll_y, 0, virtualLen, inner.GetHeight());
-                vbar.Show();
-                vbar.LeftPos(inner.right, sbw).TopPos(inner.top, inner.GetHeight());
-                vbar.SetTotal(virtualLen);
-                vbar.SetPage(inner.GetWidth());
-                const int maxpos = max(0, virtualLen - inner.GetWidth());
-                scroll_y = clamp(scroll_y, 0, maxpos);
-                vbar.Set(scroll_y);
-                lastVBarRc = Rect(inner.right, inner.top,
-                                  inner.right + sbw, inner.top + inner.GetHeight());
-            } else {
-                vbar.Hide(); scroll_y = 0; lastVBarRc = RectC(0,0,0,0);
-            }
-        }
-    }
+void StageCard::HideScrollBar() {
+    if(vbar)
+        vbar->Hide();
+    scroll_y = 0;
+    lastVBarRc = RectC(0,0,0,0);
+}
 
+void StageCard::FinishLayout(const Rect& frame_rc) {
     // Important: content frame rect (for Paint) is the *outer* frame_rc
     lastContentRc = frame_rc;
-    Refresh();
+    CommitGeometry();
+    SyncVirtual();
+    CollectSections();
+    SyncSections();
+    SyncCulling();
+    if(ScratchFootprint() != layoutFootprint)
+        ++layoutStats.resized; // a persistent buffer grew (or was freed)
+    inLayout = false;
+    if(virt && virt->refit) { // measured rows brought or removed the scrollbar
+        virt->refit = false;
+        Relayout();
+        return;
+    }
+    FlushDeferredLayouts();
+    if(notifyPending) {
+        notifyPending = false;
+        ContentChanged();
+    }
+
+    const dword chrome = ChromeHash();
+    if(chrome != lastChrome) { // header, frames or scrollbar slot moved
+        lastChrome = chrome;
+        Refresh();
+    }
 }
 
 // -------------------------- Paint --------------------------
@@ -1086,11 +2645,11 @@ void StageCard::DrawBadgeGlyph(Draw& w, const Rect& rc) const {
         return;
     }
     if(hasBadgeText && !badge.IsEmpty()) {
-        Size ts = GetTextSize(badge, metrics_.badgeFont);
+        Size ts = badgeExt.Get(badge, Metrics().badgeFont, layoutStats);
         int x = rc.left + (rc.GetWidth()  - ts.cx)/2;
         int y = rc.top  + (rc.GetHeight() - ts.cy)/2;
-        w.DrawText(x, y, badge, metrics_.badgeFont,
-                   palette_.badgeInk[HeaderStateIndex()]);
+        w.DrawText(x, y, badge, Metrics().badgeFont,
+                   Palette().badgeInk[HeaderStateIndex()]);
         return;
     }
     if(style_ref_ && !style_ref_->badgeGlyph.IsEmpty()) {
@@ -1100,7 +2659,7 @@ void StageCard::DrawBadgeGlyph(Draw& w, const Rect& rc) const {
             return;
         }
         if(!g.text.IsEmpty()) {
-            Font f = (g.font.GetHeight() > 0) ? g.font : metrics_.badgeFont;
+            Font f = (g.font.GetHeight() > 0) ? g.font : Metrics().badgeFont;
             Size ts = GetTextSize(g.text, f);
             int x = rc.left + (rc.GetWidth()  - ts.cx)/2;
             int y = rc.top  + (rc.GetHeight() - ts.cy)/2;
@@ -1110,6 +2669,9 @@ void StageCard::DrawBadgeGlyph(Draw& w, const Rect& rc) const {
 }
 
 void StageCard::Paint(Draw& w) {
+#ifdef _DEBUG
+    ThrashCount(true);
+#endif
     Size sz = GetSize();
     if(sz.cx <= 0 || sz.cy <= 0) return;
 
@@ -1145,18 +2707,22 @@ void StageCard::Paint(Draw& w) {
         p.End();
     };
 
-    const int headerInsetPx  = (headerFrameOn  && headerStrokeTh  > 0) ? (headerStrokeTh  + 1)/2 : 0;
-    const int contentInsetPx = (contentFrameOn && contentStrokeTh > 0) ? (contentStrokeTh + 1)/2 : 0;
+    const ChromeLook& cl  = *chrome_;
+    const UiPalette&  pal = Palette();
+    const UiMetrics&  mt  = Metrics();
+
+    const int headerInsetPx  = cl.header.IsFramed()  ? (cl.header.strokeTh  + 1)/2 : 0;
+    const int contentInsetPx = cl.content.IsFramed() ? (cl.content.strokeTh + 1)/2 : 0;
 
     const int hs = HeaderStateIndex();
 
     // LAYER 1: Backgrounds
-    if(cardFillOn)
-        FillRectR(Rect(sz), cardRadius, palette_.cardFill, 0);
-    if(headerFillOn && !lastHeaderRc.IsEmpty())
-        FillRectR(lastHeaderRc, headerRadius, palette_.headerFace[hs], headerInsetPx);
-    if(contentFillOn && !lastContentRc.IsEmpty())
-        FillRectR(lastContentRc, contentRadius, palette_.contentBg, contentInsetPx);
+    if(cl.card.fillOn)
+        FillRectR(Rect(sz), cl.card.radius, pal.cardFill, 0);
+    if(cl.header.fillOn && !lastHeaderRc.IsEmpty())
+        FillRectR(lastHeaderRc, cl.header.radius, pal.headerFace[hs], headerInsetPx);
+    if(cl.content.fillOn && !lastContentRc.IsEmpty())
+        FillRectR(lastContentRc, cl.content.radius, pal.contentBg, contentInsetPx);
 
     // LAYER 2: Titles / badge
     if(!lastHeaderRc.IsEmpty()) {
@@ -1164,37 +2730,37 @@ void StageCard::Paint(Draw& w) {
             DrawBadgeGlyph(p, badgeIconRc);
 
         if(!IsNull(title))
-            p.DrawText(titleX, titleY, title, metrics_.titleFont, palette_.titleInk[hs]);
+            p.DrawText(titleX, titleY, title, mt.titleFont, pal.titleInk[hs]);
         if(!IsNull(subTitle))
-            p.DrawText(subTitleX, subTitleY, subTitle, metrics_.subTitleFont,
-                       palette_.subTitleInk[hs]);
+            p.DrawText(subTitleX, subTitleY, subTitle, mt.subTitleFont,
+                       pal.subTitleInk[hs]);
 
-        if(metrics_.titleUnderlineTh > 0 && !IsNull(title)) {
+        if(mt.titleUnderlineTh > 0 && !IsNull(title)) {
             if(!underlineVertical) {
                 if(line1W > 0)
                     p.DrawRect(line1X, titleLineY, line1W,
-                               metrics_.titleUnderlineTh, palette_.underline);
+                               mt.titleUnderlineTh, pal.underline);
                 if(line2W > 0)
                     p.DrawRect(line2X, titleLineY, line2W,
-                               metrics_.titleUnderlineTh, palette_.underline);
+                               mt.titleUnderlineTh, pal.underline);
             } else {
                 if(vLineH > 0)
                     p.DrawRect(vLineX, vLineY,
-                               metrics_.titleUnderlineTh, vLineH, palette_.underline);
+                               mt.titleUnderlineTh, vLineH, pal.underline);
             }
         }
     }
 
     // LAYER 3: Frames
-    if(headerFrameOn && headerStrokeTh > 0 && !lastHeaderRc.IsEmpty())
-        StrokeRectR(lastHeaderRc, headerRadius, palette_.headerBorder[hs],
-                    headerStrokeTh, headerDashed, headerDash);
-    if(contentFrameOn && contentStrokeTh > 0 && !lastContentRc.IsEmpty())
-        StrokeRectR(lastContentRc, contentRadius, palette_.cardBorder,
-                    contentStrokeTh, contentDashed, contentDash);
-    if(cardFrameOn && cardStrokeTh > 0)
-        StrokeRectR(Rect(sz), cardRadius, palette_.cardBorder,
-                    cardStrokeTh, cardDashed, cardDash);
+    if(cl.header.IsFramed() && !lastHeaderRc.IsEmpty())
+        StrokeRectR(lastHeaderRc, cl.header.radius, pal.headerBorder[hs],
+                    cl.header.strokeTh, cl.header.dashed, cl.header.dash);
+    if(cl.content.IsFramed() && !lastContentRc.IsEmpty())
+        StrokeRectR(lastContentRc, cl.content.radius, pal.cardBorder,
+                    cl.content.strokeTh, cl.content.dashed, cl.content.dash);
+    if(cl.card.IsFramed())
+        StrokeRectR(Rect(sz), cl.card.radius, pal.cardBorder,
+                    cl.card.strokeTh, cl.card.dashed, cl.card.dash);
 
     w.DrawImage(0, 0, ib);
 }
@@ -4,6 +4,23 @@
 #include <CtrlLib/CtrlLib.h>
 #include <Painter/Painter.h>
 
+#include "StageLayout.h"
+
+// Setter name for the debug thrash detector. __builtin_FUNCTION() is in GCC,
+// Clang 9 and MSVC 16.6 (_MSC_VER 1926); other compilers report "Relayout".
+#if defined(__clang__)
+#  if defined(__has_builtin)
+#    if __has_builtin(__builtin_FUNCTION)
+#      define STAGECARD_CALLER __builtin_FUNCTION()
+#    endif
+#  endif
+#elif defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+#  define STAGECARD_CALLER __builtin_FUNCTION()
+#endif
+#ifndef STAGECARD_CALLER
+#  define STAGECARD_CALLER "Relayout"
+#endif
+
 namespace Upp {
 
 /*
@@ -39,7 +56,7 @@ Layout Model (high level)
 
 You primarily control layout with **SetStack(StackMode)**:
 
-  enum class StackMode { NONE, STACKV, STACKH };
+  enum class StackMode { NONE, STACKV, STACKH, GRID, MASONRY };
 
   • NONE   -> "manual mode":
       - StageCard does NOT position children; you do it directly on Content().
@@ -56,12 +73,65 @@ You primarily control layout with **SetStack(StackMode)**:
       - Scrollbar is horizontal if needed.
       - If you also call SetWrap(true), the layout becomes a wrapping "flow"
         (chips, tiles, etc.) with vertical scroll.
+      - Wrap layout is incremental: tile sizes are measured once when added,
+        appends only lay out the tail line, and width changes re-break lines
+        from the cached sizes. Call InvalidateContentSizes() after changing
+        the natural size of tiles that were added without explicit px/py.
+      - WrapItemSize(w, h) switches wrap to uniform tiles: every item gets
+        the same cell and its position is pure arithmetic on its index among
+        the shown items (filtered tiles leave no hole), so nothing is
+        measured and relayouts that keep the column count only place newly
+        appended tiles.
+      - SetWrapJustified(row_h) scales the tiles of every row (except the
+        last) so the row fills the full width, keeping each tile's aspect
+        ratio and the row height close to row_h. Line breaks are chosen in
+        one linear pass and the result is memoized per content width.
+
+  • GRID   -> rows x columns:
+      - Column and row tracks are fixed (px), auto (largest natural item)
+        or weighted (share the leftover space), see SetGridColumn/SetGridRow.
+      - AddGrid(c, col, row, colspan, rowspan) places a control explicitly;
+        AddFixed/AddExpand flow into the next free cell, row by row.
+      - All tracks are sized in one pass over items + tracks.
+      - Scrollbar is vertical if the rows overflow.
+
+  • MASONRY -> column packing for variable-height items:
+      - Columns come from MasonryCols(n) or MasonryColumnWidth(px) and are
+        stretched to share the width.
+      - Each item goes into the currently shortest column; AddFixed(c, px)
+        fixes its height, otherwise GetMinSize().cy is used (measured once).
+      - Appending items places only the new ones.
+
+When the mode never changes, StageCardT<Policy> fixes it at compile time:
+
+  StageCardT<StagePolicy<StageCard::StackMode::STACKH, true>> tiles; // wrap
+
+Its Layout() calls only the content layout the policy names, and
+StagePolicy<..., Scroll = false> compiles the scrollbar fitting out.
+StageCard itself dispatches on the mode at runtime.
+
+Data-driven content can be keyed instead of rebuilt:
+
+  card.SetItems(keys, factory, updater);
+
+keeps the control of every key that is still present, creates controls
+only for new keys and destroys the ones whose key is gone; incremental
+layouts keep the unchanged prefix, so appending one key places one tile.
+SetFilter(pred) and SetOrder(less) hide and reorder the existing items in
+place; relayout starts at the first slot that changed.
+
+  card.Populate(next, 4);
+
+adds thousands of controls without blocking: next() is called in slices of
+about 4 ms per event-loop turn, each slice ends in one incremental layout.
 
 Supporting calls:
 
   - StackV()       -> SetStack(StackMode::STACKV)
   - StackH()       -> SetStack(StackMode::STACKH)
   - ContentManual()-> SetStack(StackMode::NONE)
+  - ContentGrid()  -> SetStack(StackMode::GRID)
+  - SetStackMasonry() -> SetStack(StackMode::MASONRY)
   - SetWrap(true)  -> Enable wrapping when in STACKH mode.
 
 -------------------------------------------------------------------------------
@@ -120,6 +190,59 @@ Important:
         • Use STACKV and AddFixed(...); StageCard always stretches cross-axis.
         • Or use AddExpand to let it also flex in the main axis.
 
+-------------------------------------------------------------------------------
+Virtual content
+-------------------------------------------------------------------------------
+
+For very large, data-driven tile sets StageCard can keep only the tiles under
+the viewport alive:
+
+  card.SetVirtualWrap(count, size_of, create, bind);
+
+  • count    -> number of data items
+  • size_of  -> Size(int i), tile size of item i; pass Null together with
+                WrapItemSize(w, h) for uniform tiles (pure arithmetic)
+  • create   -> Ctrl *(), makes a new pooled control (the card owns it)
+  • bind     -> void (Ctrl&, int i), points a pooled control at item i
+
+Only the controls intersecting the viewport (plus SetVirtualOverscan px
+above and below) exist; they are re-bound as the card scrolls. Call
+SetVirtualCount() when the data grows or shrinks and RefreshVirtual() to
+re-bind the visible controls after the data changed in place.
+
+size_of is called once per item and cached. With EnableParallelMeasure()
+the uncached range is measured on the CoWork pool (size_of must then be
+thread safe; text extents are), binding and placement stay on the GUI
+thread, so the first layout of a large card scales with cores.
+
+  card.SetVirtualStack(count, estimate_h, create, bind);
+
+is the vertical-list counterpart for rows of different heights. Rows start
+at estimate_h and take their real height (GetMinSize().cy after bind) the
+first time they are bound. Row offsets live in a Fenwick tree, so both
+offset -> row lookup and height corrections are O(log n); corrections to
+rows above the viewport shift scroll_y by the same amount, so the visible
+rows do not jump.
+
+Painted items
+  card.SetPaintedItems(count, size_of, paint);
+drops controls altogether: items are the caller's data records and one
+pane inside the content layer calls paint(w, rect, i, state) for the items
+under its paint rect. Item rects go into a StageRectIndex (uniform grid),
+so painting, hover, click (WhenItemClick) and drag (WhenItemDrag, e.g. to
+start DoDragAndDrop with GetPaintedItemImage(i) as the sample) cost a cell
+lookup, not a scan. 100k items are a size cache and an index, no Ctrls.
+
+Sticky sections
+  card.AddSection(header);        // then AddFixed(...) the group's items
+starts a group. In STACKV and ragged wrap mode the header of the group
+under the viewport top stays pinned there and is pushed up by the next
+header. The active section is a binary search over header offsets, so a
+scroll step costs O(log n) and only moves the pinned header. With sections
+a scroll step blits the rows that stay in view, so only the strip that
+scrolled in, the pinned header's old and new rects and the content area's
+rounded edge are repainted.
+
 -------------------------------------------------------------------------------
 Manual mode
 -------------------------------------------------------------------------------
@@ -144,10 +267,39 @@ Scrolling & insets
 
   - EnableContentScroll(true)  -> allow scrollbars when content overflows.
   - EnableContentClampToPane(true) -> clamp the content viewport to the card.
+  - GetHeightForWidth(w)        -> card height needed to show all content at
+                                  width w; nested cards in a STACKV card use it.
+
+Nested cards are laid out as one tree pass: while a card runs Layout(),
+SetRect on a child card only records the rect (measurement already came
+bottom-up through GetHeightForWidth); each child runs its own Layout()
+once, with its final rect, when the parent's pass ends.
+  - EnableLayoutMemo(true)     -> STACKV/STACKH geometry goes through the
+                                  shared StageLayoutMemo (off by default: the
+                                  items are measured before the lookup, so a
+                                  hit only saves the linear solve).
+  - EnableContentCulling(true) -> (default) items fully outside the viewport
+                                  are taken out of the content layer, so they
+                                  cost nothing in paint and mouse hit-testing
+                                  (IsShown() is left alone). Focused controls
+                                  and section headers are never culled.
   - SetContentInset(...)       -> margin around the content frame.
   - SetContentInnerInset(...)  -> extra inset inside the content pane applied
                                   when laying out the children.
 
+-------------------------------------------------------------------------------
+Footprint
+-------------------------------------------------------------------------------
+
+A card starts as three Ctrls (itself, contentPane, contentLayer). The
+header pane exists only after AddHeader() / Header(); header hover and
+press are tracked by the card itself until then. The scrollbar is created
+the first time content overflows. Frame/fill/dash settings live in one
+copy-on-write block shared by all cards that keep the defaults; palette
+and metrics are read from the style (SetStyle keeps a reference, so the
+style must outlive the card) until a color or font setter gives the card
+its own copy.
+
 -------------------------------------------------------------------------------
 Typical usage patterns
 -------------------------------------------------------------------------------
@@ -198,14 +350,55 @@ Public API below: mostly styling + the stack helpers described above.
 -------------------------------------------------------------------------------
 */
 
+// Copy-on-write block: every default-constructed handle points at one
+// process-wide instance; Write() gives the handle a private copy first if
+// the block is shared. Reads never allocate.
+template <class T>
+class StageShared {
+public:
+    StageShared() : rep(Default())                    { AtomicInc(rep->refs); }
+    StageShared(const StageShared& b) : rep(b.rep)    { AtomicInc(rep->refs); }
+    ~StageShared()                                    { Release(); }
+
+    StageShared& operator=(const StageShared& b)      { AtomicInc(b.rep->refs); Release(); rep = b.rep; return *this; }
+
+    const T& operator*() const                        { return rep->data; }
+    const T* operator->() const                       { return &rep->data; }
+    bool     IsShared() const                         { return rep->refs > 1; }
+
+    T& Write() {
+        if(rep->refs > 1) {
+            Rep *r = new Rep(rep->data);
+            Release();
+            rep = r;
+        }
+        return rep->data;
+    }
+
+private:
+    struct Rep {
+        Atomic refs;
+        T      data;
+        Rep(const T& x) : data(x) { refs = 1; }
+        Rep()                     { refs = 1; }
+    };
+    Rep *rep;
+
+    void Release()       { if(AtomicDec(rep->refs) == 0) delete rep; }
+    static Rep *Default() { static Rep *r = new Rep; return r; } // keeps its own reference, never freed
+};
+
 class StageCard : public ParentCtrl {
 public:
     typedef StageCard CLASSNAME;
 
     enum HeaderAlign { LEFT, RIGHT, CENTER };
 
+    // Interaction state index (header palette, painted items)
+    enum { ST_NORMAL = 0, ST_HOT = 1, ST_PRESSED = 2, ST_DISABLED = 3, ST_COUNT = 4 };
+
     // Public-facing stacking mode
-    enum class StackMode { NONE, STACKV, STACKH };
+    enum class StackMode { NONE, STACKV, STACKH, GRID, MASONRY };
 
     // Helpers to derive per-state colors from a base
     static inline void MakeFaceStates(Color base, Color (&dst)[4],
@@ -279,7 +472,7 @@ public:
     };
 
     // ------- API: style -------
-    StageCard& SetStyle(const Style& s);      // references external style (not owned)
+    StageCard& SetStyle(const Style& s);      // references external style (not owned, must outlive the card)
     StageCard& SetStyleOwned(const Style& s); // stores a copy (owned)
     StageCard& SetPalette(const UiPalette& p);
     StageCard& SetMetrics(const UiMetrics& m);
@@ -292,25 +485,25 @@ public:
     StageCard();
 
     // ---- Header text ----
-    StageCard& SetTitle(const String& s)            { title = s; Layout(); return *this; }
-    StageCard& SetTitleFont(Font f)                 { metrics_.titleFont = f; Layout(); return *this; }
-    StageCard& SetSubTitle(const String& s)         { subTitle = s; Layout(); return *this; }
-    StageCard& SetSubTitleFont(Font f)              { metrics_.subTitleFont = f; Layout(); return *this; }
+    StageCard& SetTitle(const String& s)            { title = s; Relayout(); return *this; }
+    StageCard& SetTitleFont(Font f)                 { OwnMetrics().titleFont = f; Relayout(); return *this; }
+    StageCard& SetSubTitle(const String& s)         { subTitle = s; Relayout(); return *this; }
+    StageCard& SetSubTitleFont(Font f)              { OwnMetrics().subTitleFont = f; Relayout(); return *this; }
 
     // ---- Badge (icon or centered text) ----
-    StageCard& SetBadge(const String& s)            { badge = s; hasBadgeText = !IsNull(s); Layout(); return *this; }
-    StageCard& SetBadgeFont(Font f)                 { metrics_.badgeFont = f; Layout(); return *this; }
+    StageCard& SetBadge(const String& s)            { badge = s; hasBadgeText = !IsNull(s); Relayout(); return *this; }
+    StageCard& SetBadgeFont(Font f)                 { OwnMetrics().badgeFont = f; Relayout(); return *this; }
     StageCard& SetBadgeIcon(const Image& img, Size pref = Size(0,0))
-                                                    { badgeIcon = img; badgeIconPref = pref; hasBadgeIcon = !img.IsEmpty(); Layout(); return *this; }
-    StageCard& SetBadgeAlignment(HeaderAlign a)     { badgeAlign = a; badgeAlignExplicit = true; Layout(); return *this; }
+                                                    { badgeIcon = img; badgeIconPref = pref; hasBadgeIcon = !img.IsEmpty(); Relayout(); return *this; }
+    StageCard& SetBadgeAlignment(HeaderAlign a)     { badgeAlign = a; badgeAlignExplicit = true; Relayout(); return *this; }
 
     // Title/subtitle horizontal alignment (does not move centered icon)
-    StageCard& SetHeaderAlign(HeaderAlign a)        { headerAlign = a; Layout(); return *this; }
+    StageCard& SetHeaderAlign(HeaderAlign a)        { headerAlign = a; Relayout(); return *this; }
 
     // Underline
-    StageCard& SetTitleUnderlineThickness(int th)   { metrics_.titleUnderlineTh = max(0, th); Layout(); return *this; }
-    StageCard& SetTitleUnderlineColor(Color c)      { palette_.underline = c; Refresh(); return *this; }
-    StageCard& SetTitleUnderlineVertical(bool on = true) { underlineVertical = on; Layout(); return *this; }
+    StageCard& SetTitleUnderlineThickness(int th)   { OwnMetrics().titleUnderlineTh = max(0, th); Relayout(); return *this; }
+    StageCard& SetTitleUnderlineColor(Color c)      { OwnPalette().underline = c; Refresh(); return *this; }
+    StageCard& SetTitleUnderlineVertical(bool on = true) { underlineVertical = on; Relayout(); return *this; }
 
     // ---- Header colors (palette wiring) ----
     StageCard& SetHeaderColor(Color face_base, Color border_base);
@@ -331,26 +524,26 @@ public:
     StageCard& SetCardColors(Color fill = Color(240,240,240), Color stroke = Color(200,200,200));
 
     // ---- Frames & toggles ----
-    StageCard& EnableCardFrame(bool on = true)           { cardFrameOn = on; Refresh(); return *this; }
-    StageCard& EnableCardFill(bool on = true)            { cardFillOn  = on; Refresh(); return *this; }
-    StageCard& SetCardCornerRadius(int px)               { cardRadius  = max(DPI(0), px); Refresh(); return *this; }
-    StageCard& SetCardFrameThickness(int px)             { cardStrokeTh= max(0, px);     Refresh(); return *this; }
-    StageCard& SetCardDashPattern(const String& d)       { cardDash    = d; Refresh(); return *this; }
-    StageCard& EnableCardDash(bool on = false)           { cardDashed  = on; Refresh(); return *this; }
-
-    StageCard& EnableHeaderFrame(bool on = false)        { headerFrameOn = on; Refresh(); return *this; }
-    StageCard& EnableHeaderFill(bool on = true)          { headerFillOn  = on; Refresh(); return *this; }
-    StageCard& SetHeaderCornerRadius(int px)             { headerRadius  = max(DPI(0), px); Refresh(); return *this; }
-    StageCard& SetHeaderFrameThickness(int px)           { headerStrokeTh= max(0, px);     Refresh(); return *this; }
-    StageCard& SetHeaderDashPattern(const String& d)     { headerDash    = d; Refresh(); return *this; }
-    StageCard& EnableHeaderDash(bool on = false)         { headerDashed  = on; Refresh(); return *this; }
-
-    StageCard& EnableContentFrame(bool on = false)       { contentFrameOn = on; Refresh(); return *this; }
-    StageCard& EnableContentFill(bool on = true)         { contentFillOn  = on; Refresh(); return *this; }
-    StageCard& SetContentCornerRadius(int px)            { contentRadius  = max(DPI(0), px); Refresh(); return *this; }
-    StageCard& SetContentFrameThickness(int px)          { contentStrokeTh= max(0, px);     Refresh(); return *this; }
-    StageCard& SetContentDashPattern(const String& d)    { contentDash    = d; Refresh(); return *this; }
-    StageCard& EnableContentDash(bool on = false)        { contentDashed  = on; Refresh(); return *this; }
+    StageCard& EnableCardFrame(bool on = true)           { Chrome().card.frameOn = on; Refresh(); return *this; }
+    StageCard& EnableCardFill(bool on = true)            { Chrome().card.fillOn  = on; Refresh(); return *this; }
+    StageCard& SetCardCornerRadius(int px)               { Chrome().card.radius  = max(DPI(0), px); Refresh(); return *this; }
+    StageCard& SetCardFrameThickness(int px)             { Chrome().card.strokeTh= max(0, px);     Refresh(); return *this; }
+    StageCard& SetCardDashPattern(const String& d)       { Chrome().card.dash    = d; Refresh(); return *this; }
+    StageCard& EnableCardDash(bool on = false)           { Chrome().card.dashed  = on; Refresh(); return *this; }
+
+    StageCard& EnableHeaderFrame(bool on = false)        { Chrome().header.frameOn = on; Refresh(); return *this; }
+    StageCard& EnableHeaderFill(bool on = true)          { Chrome().header.fillOn  = on; Refresh(); return *this; }
+    StageCard& SetHeaderCornerRadius(int px)             { Chrome().header.radius  = max(DPI(0), px); Refresh(); return *this; }
+    StageCard& SetHeaderFrameThickness(int px)           { Chrome().header.strokeTh= max(0, px);     Refresh(); return *this; }
+    StageCard& SetHeaderDashPattern(const String& d)     { Chrome().header.dash    = d; Refresh(); return *this; }
+    StageCard& EnableHeaderDash(bool on = false)         { Chrome().header.dashed  = on; Refresh(); return *this; }
+
+    StageCard& EnableContentFrame(bool on = false)       { Chrome().content.frameOn = on; Refresh(); return *this; }
+    StageCard& EnableContentFill(bool on = true)         { Chrome().content.fillOn  = on; Refresh(); return *this; }
+    StageCard& SetContentCornerRadius(int px)            { Chrome().content.radius  = max(DPI(0), px); Refresh(); return *this; }
+    StageCard& SetContentFrameThickness(int px)          { Chrome().content.strokeTh= max(0, px);     Refresh(); return *this; }
+    StageCard& SetContentDashPattern(const String& d)    { Chrome().content.dash    = d; Refresh(); return *this; }
+    StageCard& EnableContentDash(bool on = false)        { Chrome().content.dashed  = on; Refresh(); return *this; }
 
     // ---- Insets & gaps (Qt-like) ----
     StageCard& SetHeaderInset(int l, int t, int r, int b);
@@ -363,10 +556,13 @@ public:
     StageCard& SetContentGap(int gx, int gy);
 
     // ---- Content behavior / sizing ----
-    StageCard& EnableContentScroll(bool on = true)        { scrollEnabled = on; Layout(); return *this; }
-    StageCard& EnableContentClampToPane(bool on = true)   { clampContentToPane = on; Layout(); return *this; }
-    StageCard& SetMinContent(Size s)                      { minContent = s; Layout(); return *this; }
-    StageCard& SetMaxContent(Size s)                      { maxContent = s; Layout(); return *this; }
+    StageCard& EnableContentScroll(bool on = true)        { scrollEnabled = on; Relayout(); return *this; }
+    StageCard& EnableContentClampToPane(bool on = true)   { clampContentToPane = on; Relayout(); return *this; }
+    StageCard& EnableContentCulling(bool on = true);
+    // Share solved stack geometry through StageLayoutMemo (off by default)
+    StageCard& EnableLayoutMemo(bool on = true)          { layoutMemo = on; return *this; }
+    StageCard& SetMinContent(Size s)                      { minContent = s; Relayout(); return *this; }
+    StageCard& SetMaxContent(Size s)                      { maxContent = s; Relayout(); return *this; }
 
     // ---- Content / layout modes ----
 
@@ -377,9 +573,72 @@ public:
     StageCard& SetStackV()    { return SetStack(StackMode::STACKV); }
     StageCard& SetStackH()    { return SetStack(StackMode::STACKH); }
     StageCard& SetStackNone() { return SetStack(StackMode::NONE);  }
+    StageCard& SetStackGrid() { return SetStack(StackMode::GRID);  }
+    StageCard& ContentGrid()  { return SetStack(StackMode::GRID);  }
+    StageCard& SetStackMasonry() { return SetStack(StackMode::MASONRY); }
 
     // Wrapping only affects horizontal stack mode (STACKH).
-    StageCard& SetWrap(bool on = true)                    { wrap = on; Layout(); return *this; }
+    StageCard& SetWrap(bool on = true)                    { wrap = on; ResetLayoutCaches(); Relayout(); return *this; }
+
+    // Uniform wrap tiles: all items share one cell size (<= 0 turns it off).
+    StageCard& WrapItemSize(int w, int h)                 { wrapItem = Size(max(0, w), max(0, h)); ResetLayoutCaches(); Relayout(); return *this; }
+    bool       IsUniformWrap() const                      { return IsWrap() && wrapItem.cx > 0 && wrapItem.cy > 0; }
+
+    // Justified wrap rows around a target row height (<= 0 turns it off).
+    StageCard& SetWrapJustified(int row_h)                { wrapJustifyH = max(0, row_h); ResetLayoutCaches(); Relayout(); return *this; }
+    bool       IsJustifiedWrap() const                    { return IsWrap() && wrapJustifyH > 0; }
+    int        GetWrapColumns() const                     { return wrapCache.cols; }
+    // Items [first, last) intersecting the viewport at the current scroll_y (uniform wrap
+    // only); hidden items inside the range take no cell.
+    void       GetWrapVisibleRange(int& first, int& last) const;
+
+    // ---- Virtual wrap (data-driven, recycled controls) ----
+    StageCard& SetVirtualWrap(int count, Function<Size (int)> size_of,
+                              Function<Ctrl *()> create, Function<void (Ctrl&, int)> bind);
+    StageCard& SetVirtualStack(int count, int estimate_h,
+                               Function<Ctrl *()> create, Function<void (Ctrl&, int)> bind);
+    StageCard& SetVirtualCount(int count);
+    StageCard& SetVirtualOverscan(int px)                 { OwnVirtual().overscan = max(0, px); SyncVirtual(); return *this; }
+    // size_of runs on the CoWork pool for large counts; it must be thread safe
+    StageCard& EnableParallelMeasure(bool on = true)      { OwnVirtual().parallel = on; return *this; }
+    StageCard& RefreshVirtual();
+    StageCard& ClearVirtual();
+    bool       IsVirtual() const                          { return virt && ((bool)virt->create || IsPainted()); }
+    int        GetVirtualCount() const                    { return virt ? virt->count : 0; }
+    int        GetVirtualPoolCount() const                { return virt ? virt->pool.GetCount() : 0; }
+
+    // ---- Painted items (owner-draw wrap, one control for all items) ----
+    // paint(w, r, i, state) draws item i into r; state is ST_NORMAL / ST_HOT /
+    // ST_PRESSED / ST_DISABLED. Sizing as SetVirtualWrap (size_of or Null +
+    // WrapItemSize); SetVirtualCount / RefreshVirtual / ClearVirtual apply.
+    StageCard& SetPaintedItems(int count, Function<Size (int)> size_of,
+                               Function<void (Draw&, const Rect&, int, int)> paint);
+    bool       IsPainted() const                          { return painted && painted->paint; }
+    int        GetPaintedItemAt(Point p) const;           // p in content coordinates, -1 = none
+    Rect       GetPaintedItemRect(int i) const;           // content coordinates
+    int        GetHotItem() const                         { return painted ? painted->hot : -1; }
+    Image      GetPaintedItemImage(int i) const;          // item drawn alone, e.g. a drag sample
+    void       RefreshPaintedItem(int i);
+
+    Event<int> WhenItemClick;  // press and release on the same painted item
+    Event<int> WhenItemDrag;   // painted item dragged past the threshold (start DnD here)
+
+    // ---- Grid tracks (GRID mode) ----
+    // px > 0: fixed track; weight > 0: shares leftover space; neither: auto.
+    StageCard& GridCols(int n)                            { gridCols = max(1, n); Relayout(); return *this; }
+    StageCard& GridCell(int w, int h)                     { gridCell = Size(max(0, w), max(0, h)); Relayout(); return *this; }
+    StageCard& GridStretch(bool on = true)                { gridStretch = on; Relayout(); return *this; }
+    StageCard& SetGridColumn(int i, int px, int weight = 0);
+    StageCard& SetGridRow   (int i, int px, int weight = 0);
+    StageCard& ClearGridTracks();
+
+    // ---- Masonry columns (MASONRY mode) ----
+    // Fixed column count, or (px > 0) as many columns of at least px as fit.
+    StageCard& MasonryCols(int n)                         { masonryCols = max(1, n); Relayout(); return *this; }
+    StageCard& MasonryColumnWidth(int px)                 { masonryColW = max(0, px); Relayout(); return *this; }
+
+    // Explicit cell placement (GRID mode)
+    StageCard& AddGrid(Ctrl& c, int col, int row, int colspan = 1, int rowspan = 1);
 
     // ---- Stack API (Fixed / Expand / Spacer) ----
     StageCard& ReplaceExpand(Ctrl& c, int w = 1);
@@ -387,6 +646,57 @@ public:
     StageCard& ReplaceFixed (Ctrl& c);
 
     StageCard& ClearContent();
+    int        GetItemCount() const                       { return items.GetCount(); } // spacers included
+
+    // ---- Keyed content: the card owns one control per key ----
+    // Diffs keys against the current list: surviving keys keep their
+    // control, new keys get factory(key), vanished keys are destroyed.
+    // updater(ctrl, i) runs for new controls and for controls whose index
+    // moved (i is its new index). Keys should be unique, a repeated key is
+    // skipped. One relayout. Replaces content added with AddFixed & co.
+    StageCard& SetItems(const Vector<String>& keys,
+                        Function<Ctrl *(const String& key)> factory,
+                        Event<Ctrl&, int> updater);
+    int        GetKeyedCount() const                      { return keyed.GetCount(); }
+    Ctrl&      GetKeyed(int i) const                      { return *keyed[i]; }
+    Ctrl*      FindKeyed(const String& key) const;
+
+    // ---- Filter / order: controls stay alive, only layout slots change ----
+    // Items failing pred are hidden and leave the layout. narrowing = pred
+    // only rejects more than the previous one (typing into a search box),
+    // so items already filtered out are not tested again.
+    StageCard& SetFilter(Gate<const Ctrl&> pred, bool narrowing = false);
+    StageCard& ClearFilter();
+    // Stable sort by less; section headers and spacers keep their slots,
+    // so each group is sorted on its own. SetItems keeps the order.
+    StageCard& SetOrder(Function<bool (const Ctrl&, const Ctrl&)> less);
+    StageCard& ClearOrder()                               { order.Clear(); return *this; }
+
+    // ---- Drag reorder (STACKV / STACKH / wrap) ----
+    // Press an item and drag it: a snapshot of it follows the mouse, the
+    // items between its slot and the target slot shift over, and on release
+    // the item list is reordered. WhenReorder(from, to) gets item indices.
+    StageCard& EnableDragReorder(bool on = true)          { dragReorder = on; return *this; }
+    Event<int, int> WhenReorder;
+
+    // ---- Time-sliced population ----
+    // next() returns a new control (the card owns it) or nullptr when done.
+    // Controls are added in slices of about budget_ms per event-loop turn,
+    // with one layout per slice; the first slice runs right away, so the
+    // viewport fills first and the content length grows as slices land.
+    StageCard& Populate(Function<Ctrl *()> next, int budget_ms = 4);
+    StageCard& CancelPopulate();
+    bool       IsPopulating() const                       { return populator && populator->next; }
+    Event<>    WhenPopulated;
+
+    // Section header: starts a new group, pinned to the top of the viewport
+    // while its group is scrolled through (STACKV and ragged wrap).
+    // h <= 0 -> GetMinSize().cy. Headers should be opaque, they overlap rows.
+    StageCard& AddSection(Ctrl& header, int h = -1);
+    int        GetActiveSection() const                   { return pinned; } // -1 = none
+
+    // Drop cached tile sizes (wrap mode) and re-measure children on next layout
+    StageCard& InvalidateContentSizes();
 
     // px/py: fixed cell size; <=0 means "use control's natural size"
     StageCard& AddFixed (Ctrl& c, int px, int py);
@@ -396,28 +706,69 @@ public:
     StageCard& AddSpacer(int weight=1);
 
     // Header children
-    StageCard& AddHeader(Ctrl& c) { headerPane.Add(c); Layout(); return *this; }
+    StageCard& AddHeader(Ctrl& c) { HeaderBand().Add(c); Relayout(); return *this; }
     StageCard& ClearHeader();
 
     // ---- Hooks ----
-    ParentCtrl& Header()  { return headerPane; }   // header band
+    ParentCtrl& Header()  { return HeaderBand(); } // header band
     ParentCtrl& Content() { return contentLayer; } // scrolled layer (use this)
 
     Size GetMinSize() const override;
+
+    // Card height that shows all content at the given card width without
+    // scrolling (memoized per width). A STACKV parent card uses it for
+    // natural-size (AddFixed without px) card rows; content changes in a
+    // nested card relayout only the ancestors whose height depends on it.
+    int  GetHeightForWidth(int width) const;
+
+    // Layout counters. `resized` counts layout passes after which the bytes
+    // reserved by the card's persistent layout buffers (ScratchFootprint)
+    // differ. It is not an allocation count: a buffer allocated and freed
+    // within one pass does not show. `measures` counts header text
+    // re-measures. Repeated layouts at an unchanged size should add neither.
+    // `placed` counts child rects staged by the layout passes; an append to
+    // an incremental mode (wrap, uniform wrap, masonry) stages only the tail.
+    struct LayoutStats {
+        int64 layouts  = 0;
+        int64 resized  = 0;
+        int64 measures = 0;
+        int64 placed   = 0;
+    };
+    const LayoutStats& GetLayoutStats() const { return layoutStats; }
+    void               ResetLayoutStats()     { layoutStats = LayoutStats(); }
+
+#ifdef _DEBUG
+    // Thrash detector: Layout() / Paint() calls per event-loop iteration.
+    // A card over budget is logged with its title, the counts and the
+    // setters that asked for the layouts ("AddFixed x40, SetTitle x1").
+    struct ThrashStats {
+        int    layouts = 0, paints = 0;         // current iteration
+        int    peakLayouts = 0, peakPaints = 0; // worst iteration so far
+        String peakSetters;                     // setters of the worst layout burst
+    };
+    const ThrashStats& GetThrashStats() const { return thrash.stats; }
+    void               ResetThrashStats()     { thrash.stats = ThrashStats(); }
+    static void        SetThrashBudget(int layouts, int paints); // per card and iteration, default 8 / 4
+#endif
+    StackMode GetStack() const;
     void Layout() override;
     void Paint(Draw& w) override;
     void MouseWheel(Point p, int zdelta, dword keyflags) override;
-
-    bool IsVerticalScroll() const { return (dir == Direction::V) || (mode == ContentMode::STACK && wrap); }
+    void ChildMouseEvent(Ctrl *child, int event, Point p, int zdelta, dword keyflags) override;
+    void MouseMove(Point p, dword keyflags) override;
+    void MouseLeave() override;
+    void LeftDown(Point p, dword keyflags) override;
+    void LeftUp(Point p, dword keyflags) override;
+    void CancelMode() override;
+
+    bool IsVerticalScroll() const { return (dir == Direction::V) || (mode == ContentMode::STACK && wrap)
+                                           || mode == ContentMode::GRID || mode == ContentMode::MASONRY; }
     bool IsWrap() const           { return mode == ContentMode::STACK && wrap && dir == Direction::H; }
 
 private:
     // ---- Internal layout enums ----
     enum class Direction   { V, H };
-    enum class ContentMode { STACK, MANUAL };
-
-    // ---- Internal state index ----
-    enum { ST_NORMAL = 0, ST_HOT = 1, ST_PRESSED = 2, ST_DISABLED = 3, ST_COUNT = 4 };
+    enum class ContentMode { STACK, MANUAL, GRID, MASONRY };
 
     // Header mouse sensor
     struct HeaderHitCtrl : ParentCtrl {
@@ -438,11 +789,23 @@ private:
     void OnHeaderLeftDown(Point, dword);
     void OnHeaderLeftUp(Point, dword);
 
+    HeaderHitCtrl& HeaderBand();
+    ScrollBar&     VBar();
+    bool           IsScrollShown() const { return vbar && vbar->IsShown(); }
+
     // ---- Style state ----
-    UiPalette   palette_;
-    UiMetrics   metrics_;
-    One<Style>  owned_style_;
-    const Style* style_ref_ = nullptr;
+    // palette_ / metrics_ exist only once a setter customizes this card;
+    // until then the style's own blocks are read in place.
+    One<UiPalette> palette_;
+    One<UiMetrics> metrics_;
+    One<Style>     owned_style_;
+    const Style*   style_ref_ = nullptr;
+
+    const Style&     CurStyle() const { return style_ref_ ? *style_ref_ : StyleDefault(); }
+    const UiPalette& Palette() const  { return palette_ ? *palette_ : CurStyle().palette; }
+    const UiMetrics& Metrics() const  { return metrics_ ? *metrics_ : CurStyle().metrics; }
+    UiPalette&       OwnPalette()     { if(!palette_) palette_.Create() = CurStyle().palette; return *palette_; }
+    UiMetrics&       OwnMetrics()     { if(!metrics_) metrics_.Create() = CurStyle().metrics; return *metrics_; }
 
     // header interaction
     bool headerStateOn_ = true;
@@ -472,27 +835,30 @@ private:
     bool    badgeAlignExplicit = false;
     Rect    badgeIconRc;
 
-    // frames/toggles
-    bool    cardFrameOn  = true;
-    bool    cardFillOn   = true;
-    int     cardRadius   = DPI(6);
-    int     cardStrokeTh = 1;
-    bool    cardDashed   = false;
-    String  cardDash     = "5,5";
-
-    bool    headerFrameOn  = false;
-    bool    headerFillOn   = true;
-    int     headerRadius   = DPI(0);
-    int     headerStrokeTh = 1;
-    bool    headerDashed   = false;
-    String  headerDash     = "5,5";
-
-    bool    contentFrameOn  = false;
-    bool    contentFillOn   = false;
-    int     contentRadius   = 0;
-    int     contentStrokeTh = 1;
-    bool    contentDashed   = false;
-    String  contentDash     = "5,5";
+    // frames/toggles, shared by every card that keeps the defaults
+    struct FrameLook {
+        bool    frameOn  = false;
+        bool    fillOn   = false;
+        int     radius   = 0;
+        int     strokeTh = 1;
+        bool    dashed   = false;
+        String  dash     = "5,5";
+
+        bool IsFramed() const { return frameOn && strokeTh > 0; }
+        int  Pad() const      { return IsFramed() ? (strokeTh + 1) / 2 + (radius > 0 ? max(1, radius / 4) : 0) : 0; }
+    };
+    struct ChromeLook {
+        FrameLook card, header, content;
+        ChromeLook() {
+            card.frameOn  = true;
+            card.fillOn   = true;
+            card.radius   = DPI(6);
+            header.fillOn = true;
+        }
+    };
+    StageShared<ChromeLook> chrome_;
+
+    ChromeLook& Chrome() { return chrome_.Write(); }
 
     // behavior / sizing
     Rect    headerInset  = Rect(DPI(0), DPI(0), DPI(0), DPI(0)); // padding around header block
@@ -504,10 +870,12 @@ private:
     int     badgeGapX    = DPI(8);
 
     // panes & scroll
-    HeaderHitCtrl headerPane { *this };
-    ParentCtrl    contentPane;
-    ParentCtrl    contentLayer;
-    ScrollBar     vbar;
+    // headerPane and vbar are created on first use (AddHeader / Header(),
+    // first overflow); most cards on a status wall never need either.
+    One<HeaderHitCtrl> headerPane;
+    ParentCtrl         contentPane;
+    ParentCtrl         contentLayer;
+    One<ScrollBar>     vbar;
     bool          scrollEnabled = true;
     int           scroll_y = 0;
 
@@ -515,6 +883,8 @@ private:
     ContentMode mode = ContentMode::STACK;
     Direction   dir  = Direction::H;
     bool        wrap = false;
+    Size        wrapItem = Size(0,0);  // uniform wrap cell, (0,0) = per-item sizes
+    int         wrapJustifyH = 0;      // justified rows target height, 0 = ragged
 
     // size rules
     bool      clampContentToPane = true;
@@ -535,18 +905,396 @@ private:
         int      fixed_w  = -1; // explicit width  (wrap)
         int      fixed_h  = -1; // explicit height (wrap)
         int      expand_w = 0;  // >0 == participates in expand distribution
-        Rect     rect;
+        Size     nat;               // cached natural size (wrap)
+        bool     measured = false;  // nat is valid
+        int      col = -1, row = -1;         // grid cell, -1 = auto flow
+        int      colspan = 1, rowspan = 1;
+        bool     section = false;   // AddSection header
+        bool     culled  = false;   // taken out of the content layer by viewport culling
+        bool     filtered = false;  // hidden by SetFilter
     };
     Vector<Item> items;
+    VectorMap<String, One<Ctrl>> keyed; // SetItems controls, in item order
+    Array<Ctrl>                  populated; // Populate controls
+    struct Populator {
+        Function<Ctrl *()> next;
+        int                budget = 4;
+        TimeCallback       tick;
+    };
+    One<Populator> populator; // created by the first Populate()
+    int       batch = 0;  // > 0: Add* only record, one Layout() when the batch ends
+    Gate<const Ctrl&>            filter;
+    Function<bool (const Ctrl&, const Ctrl&)> order;
+
+    // ---- Drag reorder state ----
+    struct DragGhost : Ctrl {
+        Image img;            // snapshot taken once when the drag starts
+        DragGhost()           { Transparent(); IgnoreMouse(); }
+        void Paint(Draw& w) override { w.DrawImage(0, 0, img); }
+    };
+    struct DragState {
+        int          item   = -1;    // pressed item
+        bool         active = false; // past the drag threshold
+        Point        start, grab;    // press point, offset inside the item (content coords)
+        Vector<int>  vis;            // item index of each slot, at drag start
+        Vector<Rect> slots;          // slot rects at drag start
+        Vector<int>  order;          // preview: original slot shown in each slot
+        int          from = -1, at = -1;
+        Rect         drop;           // preview rect of the dragged item
+        One<DragGhost> ghost;        // only while a drag is active
+    };
+    One<DragState> drag; // created by the first press on a reorderable card
+    bool      dragReorder = false;
+
+    // ---- Sticky section headers ----
+    struct Section : Moveable<Section> {
+        Ctrl* c    = nullptr;
+        Ctrl* next = nullptr;  // z-order neighbour to restore on unpin
+        Rect  rc;              // natural (unpinned) rect in content coordinates
+    };
+    Vector<Section> sections;     // in content order, rc.top ascending
+    int             pinned = -1;  // index into sections
+
+    // ---- Grid tracks ----
+    struct GridTrack : Moveable<GridTrack> {
+        int px     = 0;  // > 0 fixed size
+        int weight = 0;  // > 0 weighted; both 0 -> auto
+    };
+    Vector<GridTrack> gridColSpec, gridRowSpec;
+    int               gridCols    = 1;
+    Size              gridCell    = Size(0,0); // minimum size of auto tracks
+    bool              gridStretch = false;     // unspecified columns get weight 1
+
+    // ---- Wrap cache (incremental LayoutWrapH) ----
+    struct WrapLine : Moveable<WrapLine> {
+        int first = 0;  // position in WrapCache::idx
+        int count = 0;
+        int y     = 0;
+        int h     = 0;
+    };
+    struct WrapCache {
+        Vector<int>      idx;         // laid out item indices, in order
+        Vector<int>      scratch;     // visible indices of the current pass
+        StageSpecs       specs;       // tile sizes / breaks of the visible items
+        Vector<int>      changed;     // positions in idx whose rect changed
+        StageWrapSolver  solver;      // ragged lines (incremental)
+        Rect             inset;
+        Size             gap;
+
+        // uniform tiles (WrapItemSize)
+        int              cols   = 0;  // columns of the current placement
+        int              placed = 0;  // cells (idx entries) already at their rect
+
+        void Clear() { idx.Clear(); solver.Clear(); cols = 0; placed = 0; }
+    };
+    WrapCache wrapCache;
+
+    // ---- Justified rows, memoized per content width ----
+    struct JustifyLayout {
+        int          width  = -1;
+        int          height = 0;   // bottom of the last row (inset top included)
+        Vector<Rect> rects;        // one per JustifyCache::idx entry
+    };
+    struct JustifyCache {
+        enum { MEMO = 4 };         // widths remembered (splitter drags go back and forth)
+        Vector<int>           idx;     // laid out item indices, in order
+        Vector<int>           scratch; // visible indices of the current pass
+        Array<JustifyLayout>  memo;    // most recently used first
+        Rect                  inset;
+        Size                  gap;
+        int                   target = 0;
+
+        void Clear() { idx.Clear(); memo.Clear(); target = 0; }
+    };
+    One<JustifyCache> justifyCache; // created by the first justified pass
+
+    // ---- Virtual wrap / stack state ----
+
+    // Fenwick (binary indexed) tree over row extents
+    struct FenwickTree {
+        Vector<int> t; // 1-based partial sums
+
+        void Build(const Vector<int>& v) {
+            const int n = v.GetCount();
+            t.SetCount(n + 1);
+            t[0] = 0;
+            for(int i = 1; i <= n; ++i)
+                t[i] = v[i - 1];
+            for(int i = 1; i <= n; ++i) {
+                const int j = i + (i & -i);
+                if(j <= n) t[j] += t[i];
+            }
+        }
+        void Add(int i, int delta) {
+            for(++i; i < t.GetCount(); i += i & -i)
+                t[i] += delta;
+        }
+        int Prefix(int i) const { // sum over [0, i)
+            int s = 0;
+            for(; i > 0; i -= i & -i)
+                s += t[i];
+            return s;
+        }
+        int Total() const { return Prefix(t.GetCount() - 1); }
+        int Find(int y) const {   // number of leading entries whose sum <= y
+            const int n = t.GetCount() - 1;
+            int pos = 0, step = 1;
+            while(step * 2 <= n) step *= 2;
+            for(; step > 0; step >>= 1)
+                if(pos + step <= n && t[pos + step] <= y) {
+                    pos += step;
+                    y   -= t[pos];
+                }
+            return pos;
+        }
+    };
+
+    struct VirtualState {
+        int                          count = 0;
+        Function<Size (int)>         size;      // null -> uniform WrapItemSize cell
+        Function<Ctrl *()>           create;
+        Function<void (Ctrl&, int)>  bind;
+        int                          overscan = DPI(200);
+        bool                         stack = false; // SetVirtualStack rows
+        bool                         syncing = false;
+        bool                         refit = false;    // measured rows flipped the scrollbar mid-pass
+        bool                         parallel = false; // size_of on the CoWork pool
+
+        // stack rows
+        Vector<int>      rowH;      // estimated or measured height + gap.cy
+        Vector<byte>     rowKnown;  // rowH holds a measured height
+        FenwickTree      tree;
+        int              estimate = 0;
+
+        Vector<Size>     sizes;     // cached size_of results
+        Vector<int>      prefix;    // prefix[i] = sum of (w + gap.cx) over [0, i)
+        Vector<WrapLine> lines;     // first/count index into sizes
+        int              width = -1;
+        int              cols  = 0; // uniform tiles
+        Rect             inset;
+        Size             gap;
+
+        Array<Ctrl>      pool;      // live controls
+        Vector<int>      bound;     // item bound to each pool slot, -1 = spare
+        Vector<int>      slotOf;    // scratch: pool slot per visible item
+        Vector<int>      spare;     // scratch: free pool slots
+
+        void ClearGeometry() { sizes.Clear(); prefix.Clear(); lines.Clear(); width = -1; cols = 0;
+                               rowH.Clear(); rowKnown.Clear(); tree.t.Clear(); }
+    };
+    One<VirtualState> virt; // created by the first virtual or painted setter
+
+    VirtualState&    OwnVirtual()     { if(!virt) virt.Create(); return *virt; }
+
+    // ---- Painted items: data records drawn by one control ----
+    struct PaintedPane : Ctrl {
+        PaintedPane(StageCard& o) : owner(o) { Transparent(); }
+        void Paint(Draw& w) override                      { owner.PaintItems(w); }
+        void MouseMove(Point p, dword k) override         { owner.PaintedMouse(MOUSEMOVE, p, k); }
+        void LeftDown(Point p, dword k) override          { owner.PaintedMouse(LEFTDOWN, p, k); }
+        void LeftUp(Point p, dword k) override            { owner.PaintedMouse(LEFTUP, p, k); }
+        void MouseLeave() override                        { owner.PaintedMouse(MOUSELEAVE, Point(0, 0), 0); }
+        void MouseWheel(Point p, int z, dword k) override { owner.MouseWheel(p, z, k); }
+        StageCard& owner;
+    };
+    struct PaintedState {
+        Function<void (Draw&, const Rect&, int, int)> paint;
+        One<PaintedPane> pane;
+        StageRectIndex   index;     // item rects, content coordinates
+        Vector<int>      visible;   // scratch: items under the paint rect
+        int              hot = -1, pressed = -1;
+        Point            press;
+        bool             dragged = false;
+
+        // geometry the index was built for
+        int              count = -1, width = -1, cols = -1;
+        Rect             inset = Null;
+        Size             gap = Null, cell = Null;
+        bool             dirty = true;
+    };
+    One<PaintedState> painted; // created by SetPaintedItems, freed by ResetPainted
+
+    // ---- Masonry state (incremental LayoutMasonry) ----
+    struct MasonryCache {
+        Vector<int> idx;      // placed item indices, in order
+        Vector<int> bottom;   // next free y per column
+        Vector<int> heap;     // column indices, min-heap on (bottom, index)
+        Vector<int> scratch;  // visible indices of the current pass
+        int         cols = 0, colw = -1;
+        Rect        inset;
+        Size        gap;
+
+        void Clear() { idx.Clear(); bottom.Clear(); heap.Clear(); cols = 0; colw = -1; }
+    };
+    One<MasonryCache> masonryCache; // created by the first masonry pass
+    int          masonryCols = 2;
+    int          masonryColW = 0;
+
+    // ---- Viewport culling: items bucketed by horizontal bands ----
+    struct CullIndex {
+        int                 band = DPI(256);
+        Vector<Vector<int>> cells;       // item indices overlapping each band
+        Vector<Rect>        at;          // rect each item is indexed under
+        Index<Ctrl*>        ctrl;        // control of each indexed item
+        Vector<Ctrl*>       moved;       // controls CommitGeometry moved this pass
+        Vector<int>         enter;       // scratch: items coming back on screen
+        Rect                view = Null; // window the culled flags reflect, Null = none yet
+        int                 culled = 0;  // items currently out of the layer
+
+        void Clear() { cells.Clear(); at.Clear(); ctrl.Clear(); moved.Clear(); view = Null; }
+    };
+    One<CullIndex> cullIndex; // created by the first pass that can cull
+    bool      cullOn = true;
+
+    // ---- Height-for-width memo and upward size notification ----
+    enum { HFW_MEMO = 4 };
+    mutable Vector<Size> hfwMemo;          // (width, height), most recent first
+    bool                 inLayout      = false;
+    bool                 notifyPending = false; // content changed during Layout()
+
+    // ---- Reusable layout temporaries (steady-state layout does not allocate) ----
+    struct LayoutScratch {
+        StageSpecs       stack;       // STACKV / STACKH item specs
+        Vector<Ctrl*>    stackCtrl;   // control per spec, nullptr = spacer
+        StageGeometry    geom;        // solver output
+        Vector<Item>     rebuilt;
+        Vector<int>      vis, col, colspan, row, rowspan, natw, nath; // grid items
+        Vector<int>      colPos, colSize, rowPos, rowSize;            // grid tracks
+        Vector<byte>     taken;                                       // grid cells held by AddGrid items
+    };
+    struct TextExtent {
+        String text;
+        Font   font;
+        Size   size = Null;
+        Size   Get(const String& s, Font f, LayoutStats& st);
+    };
+    LayoutScratch       scratch;
+    bool                layoutMemo = false;
+    mutable LayoutStats layoutStats;
+    int64               layoutFootprint = 0;  // ScratchFootprint() when the pass began
+    mutable TextExtent  titleExt, subTitleExt, badgeExt;
+
+#ifdef _DEBUG
+    struct ThrashMeter {
+        ThrashStats            stats;
+        const char            *setter = nullptr; // Relayout caller of the running Layout()
+        VectorMap<String, int> by;               // layouts per setter, this iteration
+        bool                   armed = false;    // flush posted for this iteration
+        TimeCallback           tick;
+    };
+    mutable ThrashMeter thrash;
+    void ThrashCount(bool paint) const;
+    void ThrashFlush() const;
+    // Internal relayout; debug builds remember which setter asked for it
+    void Relayout(const char *from = STAGECARD_CALLER)     { thrash.setter = from; Layout(); thrash.setter = nullptr; }
+    void Reflow(const char *from = STAGECARD_CALLER)       { if(!ContentChangedLaidOut()) Relayout(from); }
+#else
+    void Relayout()                                        { Layout(); }
+    void Reflow()                                          { if(!ContentChangedLaidOut()) Relayout(); }
+#endif
+
+    template <class T>
+    void  ReserveScratch(Vector<T>& v, int n) { if(v.GetAlloc() < n) v.Reserve(n); }
+    int64 ScratchFootprint() const;
+
+    // ---- Geometry commit: layout computes, CommitGeometry applies diffs ----
+    VectorMap<Ctrl*, Rect> staged;
+    dword                  lastChrome = 0;
+    void                   Place(Ctrl& c, const Rect& r);
+    void                   CommitGeometry();
+    dword                  ChromeHash() const;
+
+    // ---- Tree layout pass: nested cards lay out once, after placement ----
+    bool                 layoutDeferred = false; // placed by a parent mid-pass
+    Vector<StageCard*>   deferredKids;           // cards waiting for our pass to end
+    void                 FlushDeferredLayouts();
+
+    Rect       ChromeMargins() const;      // card rect -> content inner rect
+    StageCard* ParentCard() const;
+    bool       UsesHeightForWidth(const Item& it) const;
+    void       ContentChanged();
+    bool       ContentChangedLaidOut();
+    void       ChildSizeChanged(StageCard& child);
 
     // helpers
     static void ClearChildren(ParentCtrl& p);
     void RebuildItemsFromChildrenIfNeeded();
     int  MeasureNaturalPrimaryForWidth(int pane_w) const;
     int  MeasureNaturalPrimaryForHeight(int pane_h) const;
+    void GatherStackSpecs(bool vertical, int cross);
+    StageFrame ContentFrame(const Rect& inner) const;
+
+    // ---- Layout pass: chrome, content (runtime or policy dispatch), finish ----
+    template <class Policy> friend class StageCardT;
+    void ApplyStack(StackMode m); // mode / dir only, no layout
+    bool LayoutChrome(Rect& frame_rc, Rect& inner);
+    void LayoutContent(Rect inner);
+    template <class Policy>
+    void LayoutContentAs(Rect inner);
+    void BeginContent(const Rect& inner);
+    void FinishLayout(const Rect& frame_rc);
+    // Lay out with lay(inner); when the content overflows, take the scrollbar
+    // slot off the pane and lay out again. along_w: content runs along the width.
+    template <bool Scroll, class L>
+    void FitScrolled(Rect& inner, bool along_w, L lay);
+    template <bool Scroll>
+    void LayoutManual(Rect& inner, bool vertical);
+    int  ManualContentLen(bool vertical) const;
+    void ShowScrollBar(const Rect& inner, int page);
+    void HideScrollBar();
+
     void LayoutStackV(const Rect& inner);
     void LayoutStackH(const Rect& inner);
     void LayoutWrapH (const Rect& inner);
+    void LayoutGrid  (const Rect& inner);
+    bool IsItemShown(const Item& it) const { return it.c && it.c->IsShown(); }
+    bool CanCull() const;
+    void CullItem(int i, bool out);
+    void AttachEntering();
+    void CullBands(int top, int bottom, const Rect& view);
+    void UnindexItem(int i);
+    void IndexItem(int i, const Rect& r);
+    void SyncCulling();
+    void UncullAll();
+    void CollectSections();
+    void UnpinSection();
+    void SyncSections();
+    void ScrollContentView(int dx, int dy);
+    void LayoutVirtualWrap(const Rect& inner);
+    void LayoutVirtualStack(const Rect& inner);
+    void RebuildVirtualRows();
+    Rect VirtualItemRect(int i) const;
+    void GetVirtualRange(int top, int bottom, int& first, int& last) const;
+    void SyncVirtual();
+    bool BindVirtualRange(int& first, int& last);
+    void SyncPainted();
+    void ResetPainted();
+    void PaintItems(Draw& w);
+    void PaintedMouse(int event, Point p, dword keyflags);
+    int  ItemState(int i) const;
+    void LayoutMasonry(const Rect& inner);
+    void ResetLayoutCaches();
+    void ItemsChangedFrom(int first);
+    bool FilterItem(Item& it, bool out);
+    int  FilterItems(int from, bool narrowing);
+    int  SortItems();
+    void SyncKeyedOrder();
+    void ClearOwned();
+    void PopulateSlice();
+    Point ContentPoint(Ctrl& from, Point p) const;
+    void  DragBegin();
+    void  DragMove(Point q);
+    void  DragEnd(bool commit);
+    int   DragSlotAt(Point q) const;
+    void  DragPreview(int lo, int hi);
+    static void SizeGridTracks(const Vector<GridTrack>& spec, int count, int def_px, int def_weight,
+                               const Vector<int>& at, const Vector<int>& span, const Vector<int>& nat,
+                               int gap, int avail, Vector<int>& pos, Vector<int>& size);
+    Size MeasureWrapItem(Item& it);
+    void LayoutWrapUniform(const Rect& inner);
+    void LayoutWrapJustified(const Rect& inner);
+    void BreakJustifiedRows(JustifyLayout& jl, int avail_w, const Rect& eff);
+    Rect UniformTileRect(int cell) const;
     int  HeaderHeight() const;
 
     // style helpers
@@ -555,5 +1303,131 @@ private:
     void        DrawBadgeGlyph(Draw& w, const Rect& rc) const;
 };
 
+// A card that already scrolls is laid out at the narrowed width first: it
+// usually still overflows, so that is one pass, and the incremental caches
+// (wrap lines, uniform placement, masonry heap) keep seeing one width.
+template <bool Scroll, class L>
+void StageCard::FitScrolled(Rect& inner, bool along_w, L lay)
+{
+    if constexpr(Scroll) {
+        auto page = [&] { return along_w ? inner.GetWidth() : inner.GetHeight(); };
+        const Rect full = inner;
+        auto Narrow = [&] {
+            contentPane.SetRect(full.left, full.top, full.GetWidth() - DPI(14), full.GetHeight());
+            inner = contentPane.GetRect();
+        };
+        if(scrollEnabled && IsScrollShown()) {
+            Narrow();
+            lay(inner);
+            if(virtualLen <= page()) { // fits without the bar now
+                contentPane.SetRect(full);
+                inner = full;
+                lay(inner);
+            }
+        }
+        else {
+            lay(inner);
+            if(scrollEnabled && virtualLen > page()) {
+                Narrow();
+                lay(inner);
+            }
+        }
+        if(scrollEnabled && virtualLen > page())
+            ShowScrollBar(inner, page());
+        else
+            HideScrollBar();
+    }
+    else {
+        lay(inner);
+        HideScrollBar();
+    }
+}
+
+template <bool Scroll>
+void StageCard::LayoutManual(Rect& inner, bool vertical)
+{
+    const int len = ManualContentLen(vertical);
+    FitScrolled<Scroll>(inner, !vertical, [&](const Rect& r) {
+        if(vertical) {
+            virtualLen = max(r.GetHeight(), len);
+            contentLayer.SetRect(0, -scroll_y, r.GetWidth(), virtualLen);
+        } else {
+            virtualLen = max(r.GetWidth(), len);
+            contentLayer.SetRect(-scroll_y, 0, virtualLen, r.GetHeight());
+        }
+    });
+}
+
+template <class Policy>
+void StageCard::LayoutContentAs(Rect inner)
+{
+    constexpr StackMode m = Policy::mode;
+    BeginContent(inner);
+    if constexpr(m == StackMode::STACKV)
+        FitScrolled<Policy::scroll>(inner, false, [&](const Rect& r) { LayoutStackV(r); });
+    else if constexpr(m == StackMode::STACKH && Policy::wrap)
+        FitScrolled<Policy::scroll>(inner, false, [&](const Rect& r) { LayoutWrapH(r); });
+    else if constexpr(m == StackMode::STACKH)
+        FitScrolled<Policy::scroll>(inner, true,  [&](const Rect& r) { LayoutStackH(r); });
+    else if constexpr(m == StackMode::GRID)
+        FitScrolled<Policy::scroll>(inner, false, [&](const Rect& r) { LayoutGrid(r); });
+    else if constexpr(m == StackMode::MASONRY)
+        FitScrolled<Policy::scroll>(inner, false, [&](const Rect& r) { LayoutMasonry(r); });
+    else
+        LayoutManual<Policy::scroll>(inner, Policy::vertical);
+}
+
+// Compile-time layout policy for StageCardT
+//   Mode     -> content layout (StackMode)
+//   Wrap     -> STACKH wraps into rows (vertical scroll)
+//   Scroll   -> false compiles the scrollbar out
+//   Vertical -> scroll axis of manual (NONE) content
+template <StageCard::StackMode Mode, bool Wrap = false, bool Scroll = true, bool Vertical = true>
+struct StagePolicy {
+    static constexpr StageCard::StackMode mode = Mode;
+    static constexpr bool wrap     = Wrap;
+    static constexpr bool scroll   = Scroll;
+    static constexpr bool vertical = Vertical;
+};
+
+// StageCard with its layout mode fixed at compile time: Layout() calls the
+// one content layout the policy names, other modes and (with Scroll = false)
+// the scrollbar fitting are not instantiated. Mode setters (SetStack,
+// SetWrap, EnableContentScroll) must not be used on it.
+//
+//   StageCardT<StagePolicy<StageCard::StackMode::STACKV>> list;
+template <class Policy>
+class StageCardT : public StageCard {
+public:
+    typedef StageCardT CLASSNAME;
+
+    StageCardT();
+    void Layout() override;
+};
+
+template <class Policy>
+StageCardT<Policy>::StageCardT()
+{
+    // All policy state first: Relayout() already dispatches to our Layout()
+    ApplyStack(Policy::mode);
+    if(Policy::mode == StackMode::NONE)
+        dir = Policy::vertical ? Direction::V : Direction::H;
+    wrap          = Policy::wrap;
+    scrollEnabled = Policy::scroll;
+    ResetLayoutCaches();
+    Relayout();
+}
+
+template <class Policy>
+void StageCardT<Policy>::Layout()
+{
+    ASSERT(GetStack() == Policy::mode && wrap == Policy::wrap && scrollEnabled == Policy::scroll);
+    Rect frame_rc, inner;
+    if(LayoutChrome(frame_rc, inner)) {
+        LayoutContentAs<Policy>(inner);
+        FinishLayout(frame_rc);
+    }
+}
+
 } // namespace Upp
 #endif
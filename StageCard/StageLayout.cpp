@@ -0,0 +1,530 @@
+#include "StageLayout.h"
+
+namespace Upp {
+
+// -------------------------- Stack --------------------------
+// Sizing is two branch-light passes over the spec arrays: totals, then
+// extents; offsets are a running sum.
+void StageSolveStack(const StageSpecs& specs, bool vertical, const StageFrame& f, StageGeometry& out)
+{
+    const int  cnt    = specs.GetCount();
+    const int *nat    = vertical ? specs.cy.begin() : specs.cx.begin();
+    const int *weight = specs.weight.begin();
+    const int  avail  = vertical ? f.AvailH() : f.AvailW();
+    const int  cross  = vertical ? f.AvailW() : f.AvailH();
+    const int  lo     = vertical ? f.inset.top : f.inset.left;
+    const int  hi     = vertical ? f.inset.bottom : f.inset.right;
+    const int  gap    = vertical ? f.gap.cy : f.gap.cx;
+
+    int natural_fixed = 0, expand_weight = 0, expand_min = 0, expand_count = 0;
+    for(int i = 0; i < cnt; ++i) {
+        const int e = weight[i] > 0;
+        natural_fixed += nat[i] & (e - 1);    // e ? 0 : nat
+        expand_min     = max(expand_min, nat[i] & -e);
+        expand_weight += weight[i];
+        expand_count  += e;
+    }
+
+    const int total_gaps = (cnt > 0 ? (cnt - 1) * gap : 0);
+    const int needed = lo + natural_fixed + hi + total_gaps + expand_min * expand_count;
+    const int extra  = max(0, avail - needed);
+
+    out.rects.SetCount(cnt);
+    Rect *r = out.rects.begin();
+    int at = lo;
+    auto Len = [&](int i) { return weight[i] > 0 ? expand_min + (extra * weight[i]) / expand_weight : nat[i]; };
+    if(vertical) { // one loop per axis, no per-item axis select
+        const int x0 = f.inset.left, x1 = x0 + cross;
+        for(int i = 0; i < cnt; ++i) {
+            const int len = Len(i);
+            r[i] = Rect(x0, at, x1, at + len);
+            at += len + gap;
+        }
+    }
+    else {
+        const int y0 = f.inset.top, y1 = y0 + cross;
+        for(int i = 0; i < cnt; ++i) {
+            const int len = Len(i);
+            r[i] = Rect(at, y0, at + len, y1);
+            at += len + gap;
+        }
+    }
+    out.virtualLen = max(avail, needed);
+}
+
+// -------------------------- Shared memo --------------------------
+namespace {
+
+struct MemoEntry {
+    uint64        key  = 0;
+    int           kind = 0;
+    StageFrame    frame;
+    StageSpecs    specs;  // full key inputs, compared on every hit
+    StageGeometry geom;
+};
+
+struct MemoStore {
+    Array<MemoEntry> lru;        // most recently used first
+    int              cap    = 32;
+    int64            hits   = 0;
+    int64            misses = 0;
+};
+
+StaticMutex sMemoLock;
+
+MemoStore& Memo()
+{
+    static MemoStore m;
+    return m;
+}
+
+// 64-bit FNV-1a over 32-bit words
+struct Hash64 {
+    uint64 h = 14695981039346656037ull;
+    void Put(int v) { h = (h ^ (dword)v) * 1099511628211ull; }
+    template <class T>
+    void Put(const Vector<T>& v) { Put(v.GetCount()); for(const T& x : v) Put((int)x); }
+};
+
+template <class T>
+bool SameItems(const Vector<T>& a, const Vector<T>& b)
+{
+    if(a.GetCount() != b.GetCount())
+        return false;
+    for(int i = 0; i < a.GetCount(); ++i)
+        if(a[i] != b[i])
+            return false;
+    return true;
+}
+
+template <class T>
+void CopyItems(Vector<T>& dst, const Vector<T>& src) // reuses dst's buffer
+{
+    dst.SetCount(src.GetCount());
+    for(int i = 0; i < src.GetCount(); ++i)
+        dst[i] = src[i];
+}
+
+bool SameInputs(const MemoEntry& e, const StageSpecs& specs, const StageFrame& f, int kind)
+{
+    return e.kind == kind && e.frame.viewport == f.viewport && e.frame.inset == f.inset
+           && e.frame.gap == f.gap
+           && SameItems(e.specs.cx, specs.cx) && SameItems(e.specs.cy, specs.cy)
+           && SameItems(e.specs.weight, specs.weight) && SameItems(e.specs.flags, specs.flags);
+}
+
+}
+
+uint64 StageLayoutMemo::Key(const StageSpecs& specs, const StageFrame& f, int kind)
+{
+    Hash64 h;
+    h.Put(kind);
+    h.Put(f.viewport.cx); h.Put(f.viewport.cy);
+    h.Put(f.inset.left);  h.Put(f.inset.top); h.Put(f.inset.right); h.Put(f.inset.bottom);
+    h.Put(f.gap.cx);      h.Put(f.gap.cy);
+    h.Put(specs.cx);
+    h.Put(specs.cy);
+    h.Put(specs.weight);
+    h.Put(specs.flags);
+    return h.h;
+}
+
+bool StageLayoutMemo::Get(const StageSpecs& specs, const StageFrame& f, int kind, StageGeometry& out)
+{
+    const uint64 key = Key(specs, f, kind);
+    Mutex::Lock __(sMemoLock);
+    MemoStore& m = Memo();
+    for(int i = 0; i < m.lru.GetCount(); ++i)
+        if(m.lru[i].key == key && SameInputs(m.lru[i], specs, f, kind)) {
+            if(i > 0)
+                m.lru.Insert(0, m.lru.Detach(i));
+            const StageGeometry& g = m.lru[0].geom;
+            CopyItems(out.rects, g.rects);
+            out.virtualLen = g.virtualLen;
+            ++m.hits;
+            return true;
+        }
+    ++m.misses;
+    return false;
+}
+
+void StageLayoutMemo::Put(const StageSpecs& specs, const StageFrame& f, int kind, const StageGeometry& g)
+{
+    const uint64 key = Key(specs, f, kind);
+    Mutex::Lock __(sMemoLock);
+    MemoStore& m = Memo();
+    if(m.cap <= 0)
+        return;
+    MemoEntry *e;
+    if(m.lru.GetCount() >= m.cap)
+        e = m.lru.Detach(m.lru.GetCount() - 1); // recycle the oldest entry
+    else
+        e = new MemoEntry;
+    e->key   = key;
+    e->kind  = kind;
+    e->frame = f;
+    CopyItems(e->specs.cx, specs.cx);
+    CopyItems(e->specs.cy, specs.cy);
+    CopyItems(e->specs.weight, specs.weight);
+    CopyItems(e->specs.flags, specs.flags);
+    CopyItems(e->geom.rects, g.rects);
+    e->geom.virtualLen = g.virtualLen;
+    m.lru.Insert(0, e);
+}
+
+void StageLayoutMemo::SetCapacity(int entries)
+{
+    Mutex::Lock __(sMemoLock);
+    MemoStore& m = Memo();
+    m.cap = max(0, entries);
+    m.lru.Trim(min(m.lru.GetCount(), m.cap));
+}
+
+void StageLayoutMemo::Clear()
+{
+    Mutex::Lock __(sMemoLock);
+    Memo().lru.Clear();
+}
+
+int64 StageLayoutMemo::GetAlloc()
+{
+    Mutex::Lock __(sMemoLock);
+    const MemoStore& m = Memo();
+    int64 n = 0;
+    for(int i = 0; i < m.lru.GetCount(); ++i)
+        n += sizeof(MemoEntry) + (int64)m.lru[i].geom.rects.GetAlloc() * sizeof(Rect)
+           + (int64)m.lru[i].specs.GetAlloc() * (3 * sizeof(int) + 1);
+    return n;
+}
+
+int64 StageLayoutMemo::GetHits()   { Mutex::Lock __(sMemoLock); return Memo().hits; }
+int64 StageLayoutMemo::GetMisses() { Mutex::Lock __(sMemoLock); return Memo().misses; }
+
+void StageSolveStackMemo(const StageSpecs& specs, bool vertical, const StageFrame& f, StageGeometry& out)
+{
+    const int kind = vertical ? StageLayoutMemo::STACK_V : StageLayoutMemo::STACK_H;
+    if(StageLayoutMemo::Get(specs, f, kind, out))
+        return;
+    StageSolveStack(specs, vertical, f, out);
+    StageLayoutMemo::Put(specs, f, kind, out);
+}
+
+// -------------------------- Measure --------------------------
+void StageMeasureSizes(const Function<Size (int)>& size_of, int from, int to,
+                       Vector<Size>& out, bool parallel)
+{
+    Size *o = out.begin();
+    if(parallel && to - from >= 256) // below that the pool hand-off costs more than it saves
+        CoPartition(from, to, [&](int a, int b) {
+            for(int i = a; i < b; ++i)
+                o[i] = size_of(i);
+        });
+    else
+        for(int i = from; i < to; ++i)
+            o[i] = size_of(i);
+}
+
+// -------------------------- Rect index --------------------------
+void StageRectIndex::Clear()
+{
+    rects.Clear();
+    start.Clear();
+    ids.Clear();
+    bounds = Rect(0, 0, 0, 0);
+    cell = 1;
+    cols = rows = 0;
+}
+
+int StageRectIndex::GetAlloc() const
+{
+    return rects.GetAlloc() * sizeof(Rect) + (start.GetAlloc() + ids.GetAlloc()) * sizeof(int);
+}
+
+void StageRectIndex::Build(Vector<Rect>&& r, int cell_px)
+{
+    want  = cell_px;
+    rects = pick(r);
+    start.SetCount(0);
+    ids.SetCount(0);
+    const int n = rects.GetCount();
+    bounds = Rect(0, 0, 0, 0);
+    cols = rows = 0;
+    if(n == 0)
+        return;
+
+    int64 sum = 0;
+    bounds = rects[0];
+    for(const Rect& q : rects) {
+        bounds.left   = min(bounds.left, q.left);
+        bounds.top    = min(bounds.top, q.top);
+        bounds.right  = max(bounds.right, q.right);
+        bounds.bottom = max(bounds.bottom, q.bottom);
+        sum += q.GetWidth() + q.GetHeight();
+    }
+    // about four average items per cell; grow the cell until the grid stays
+    // within a few slots per rect
+    cell = max(8, cell_px > 0 ? cell_px : (int)(sum / n));
+    for(;;) {
+        cols = max(1, (bounds.GetWidth()  + cell - 1) / cell);
+        rows = max(1, (bounds.GetHeight() + cell - 1) / cell);
+        if((int64)cols * rows <= 4 * (int64)n + 64)
+            break;
+        cell *= 2;
+    }
+
+    // count, prefix, fill: ids of one cell come out in ascending order
+    start.SetCount(cols * rows + 1, 0);
+    for(const Rect& q : rects) {
+        if(q.IsEmpty())
+            continue;
+        const int x0 = CellX(q.left), x1 = CellX(q.right - 1);
+        for(int y = CellY(q.top), y1 = CellY(q.bottom - 1); y <= y1; ++y)
+            for(int x = x0; x <= x1; ++x)
+                ++start[y * cols + x + 1];
+    }
+    for(int c = 0; c < cols * rows; ++c)
+        start[c + 1] += start[c];
+    ids.SetCount(start.Top());
+    Vector<int> at = clone(start);
+    for(int i = 0; i < n; ++i) {
+        const Rect& q = rects[i];
+        if(q.IsEmpty())
+            continue;
+        const int x0 = CellX(q.left), x1 = CellX(q.right - 1);
+        for(int y = CellY(q.top), y1 = CellY(q.bottom - 1); y <= y1; ++y)
+            for(int x = x0; x <= x1; ++x)
+                ids[at[y * cols + x]++] = i;
+    }
+}
+
+void StageRectIndex::Append(const Vector<Rect>& more)
+{
+    if(more.IsEmpty())
+        return;
+    Rect b = bounds;
+    for(const Rect& q : more) {
+        b.left   = min(b.left, q.left);
+        b.top    = min(b.top, q.top);
+        b.right  = max(b.right, q.right);
+        b.bottom = max(b.bottom, q.bottom);
+    }
+    const int n    = rects.GetCount() + more.GetCount();
+    const int rows2 = max(rows, (b.GetHeight() + cell - 1) / cell);
+    if(cols == 0 || b.left < bounds.left || b.top < bounds.top || b.right > bounds.left + cols * cell
+       || (int64)cols * rows2 > 4 * (int64)n + 64) { // outside the grid or too many cells
+        Vector<Rect> all = clone(rects);
+        all.Append(more);
+        Build(pick(all), want);
+        return;
+    }
+
+    const int n0 = rects.GetCount();
+    rects.Append(more);
+    bounds = b;
+    rows   = rows2;
+    const int nc = cols * rows;
+    const int total = start.Top();
+    start.SetCount(nc + 1, total); // new rows start out empty
+
+    int c0 = nc; // cells before the first one a new rect touches keep their slices
+    for(int i = n0; i < n; ++i)
+        if(!rects[i].IsEmpty())
+            c0 = min(c0, CellY(rects[i].top) * cols + CellX(rects[i].left));
+    if(c0 == nc)
+        return;
+
+    // add[k]: new entries in cells [c0, c0 + k)
+    Vector<int> add;
+    add.SetCount(nc - c0 + 1, 0);
+    auto Each = [&](int i, auto fn) {
+        const Rect& q = rects[i];
+        const int x0 = CellX(q.left), x1 = CellX(q.right - 1);
+        for(int y = CellY(q.top), y1 = CellY(q.bottom - 1); y <= y1; ++y)
+            for(int x = x0; x <= x1; ++x)
+                fn(y * cols + x);
+    };
+    for(int i = n0; i < n; ++i)
+        if(!rects[i].IsEmpty())
+            Each(i, [&](int c) { ++add[c - c0 + 1]; });
+    for(int k = 0; k < nc - c0; ++k)
+        add[k + 1] += add[k];
+
+    // Old slices move up by the new entries in front of them (last cell
+    // first, so nothing is overwritten), then the new ids go after them:
+    // they are larger than every old id, so each cell stays ascending.
+    ids.SetCount(ids.GetCount() + add.Top());
+    Vector<int> at;
+    at.SetCount(nc - c0);
+    for(int c = nc - 1; c >= c0; --c) {
+        const int a = start[c], e = start[c + 1], d = add[c - c0];
+        for(int k = e; k-- > a; )
+            ids[k + d] = ids[k];
+        at[c - c0] = e + d;
+    }
+    for(int c = c0; c <= nc; ++c)
+        start[c] += add[c - c0];
+    for(int i = n0; i < n; ++i)
+        if(!rects[i].IsEmpty())
+            Each(i, [&](int c) { ids[at[c - c0]++] = i; });
+}
+
+int StageRectIndex::Find(Point p) const
+{
+    if(cols == 0 || !bounds.Contains(p))
+        return -1;
+    const int c = CellY(p.y) * cols + CellX(p.x);
+    for(int k = start[c + 1]; k-- > start[c]; ) // topmost (last added) first
+        if(rects[ids[k]].Contains(p))
+            return ids[k];
+    return -1;
+}
+
+void StageRectIndex::Query(const Rect& r, Vector<int>& out) const
+{
+    out.SetCount(0);
+    if(cols == 0 || !bounds.Intersects(r))
+        return;
+    const int x0 = CellX(r.left), x1 = CellX(r.right - 1);
+    const int y0 = CellY(r.top),  y1 = CellY(r.bottom - 1);
+    for(int y = y0; y <= y1; ++y)
+        for(int x = x0; x <= x1; ++x) {
+            const int c = y * cols + x;
+            for(int k = start[c]; k < start[c + 1]; ++k) {
+                const Rect& q = rects[ids[k]];
+                // a rect spanning several cells is reported by the first
+                // one that is also inside r
+                if(max(CellX(q.left), x0) == x && max(CellY(q.top), y0) == y && q.Intersects(r))
+                    out.Add(ids[k]);
+            }
+        }
+    Sort(out);
+}
+
+// -------------------------- Wrap --------------------------
+void StageSolveWrap(const StageSpecs& specs, const StageFrame& f, StageGeometry& out)
+{
+    StageWrapSolver ws;
+    Vector<int> changed;
+    out.virtualLen = ws.Solve(specs, 0, f, changed);
+    out.rects = clone(ws.GetRects());
+}
+
+void StageWrapSolver::Clear()
+{
+    prefix.Clear();
+    heads.Clear();
+    lines.Clear();
+    fresh.Clear();
+    rects.Clear();
+    width = -1;
+    inset = Null;
+    gap   = Null;
+    virtualLen = 0;
+}
+
+int StageWrapSolver::GetAlloc() const
+{
+    return (prefix.GetAlloc() + heads.GetAlloc()) * sizeof(int)
+         + (lines.GetAlloc() + fresh.GetAlloc()) * sizeof(Line)
+         + rects.GetAlloc() * sizeof(Rect);
+}
+
+// Incremental wrap:
+//  - prefix sums of (w + gap) turn "how many tiles fit on this line" into a
+//    binary search;
+//  - work restarts at the line holding the first changed tile (the tail
+//    line for appends); a new width re-breaks every line;
+//  - a BREAK spec gets a full-width line of its own, lines never run
+//    across one.
+int StageWrapSolver::Solve(const StageSpecs& specs, int keep, const StageFrame& f, Vector<int>& changed)
+{
+    changed.SetCount(0);
+    const int n       = specs.GetCount();
+    const int avail_w = f.AvailW();
+
+    // Geometry inputs changed -> every tile moves, nothing to reuse
+    if(inset != f.inset || gap != f.gap) {
+        Clear();
+        inset = f.inset;
+        gap   = f.gap;
+    }
+    keep = clamp(keep, 0, min(n, rects.GetCount()));
+
+    heads.SetCount(0);
+    for(int k = 0; k < n; ++k)
+        if(specs.flags[k] & StageSpecs::BREAK)
+            heads.Add(k);
+
+    prefix.SetCount(n + 1);
+    prefix[0] = 0;
+    for(int k = keep; k < n; ++k)
+        prefix[k + 1] = prefix[k] + specs.cx[k] + gap.cx;
+    rects.SetCount(n);
+
+    // Same width: restart at the line holding the first changed tile.
+    const bool same_width = (width == avail_w);
+    int line = 0;
+    if(same_width)
+        while(line < lines.GetCount() && lines[line].first + lines[line].count < keep)
+            ++line;
+    const bool resume = same_width && line < lines.GetCount();
+    int k = resume ? lines[line].first : 0;
+    int y = resume ? lines[line].y     : inset.top;
+
+    // Next break at or after k
+    int head = 0;
+    for(int lo = 0, hi = heads.GetCount(); lo < hi; ) {
+        const int mid = (lo + hi) / 2;
+        if(heads[mid] < k) lo = head = mid + 1;
+        else               hi = mid;
+    }
+
+    fresh.SetCount(0);
+    while(k < n) {
+        while(head < heads.GetCount() && heads[head] < k)
+            ++head;
+        const bool is_head = head < heads.GetCount() && heads[head] == k;
+        const int  stop    = is_head ? k + 1
+                           : head < heads.GetCount() ? heads[head] : n;
+
+        // Largest j with prefix[j] - prefix[k] - gap <= avail_w, at least k+1
+        const int limit = prefix[k] + avail_w + gap.cx;
+        int lo = k + 1, hi = stop;
+        while(lo < hi) {
+            const int mid = (lo + hi + 1) / 2;
+            if(prefix[mid] <= limit) lo = mid;
+            else                     hi = mid - 1;
+        }
+        const int j = lo;
+
+        Line& ln = fresh.Add();
+        ln.first = k;
+        ln.count = j - k;
+        ln.y     = y;
+        for(int q = k; q < j; ++q)
+            ln.h = max(ln.h, specs.cy[q]);
+
+        for(int q = k; q < j; ++q) {
+            const int nx = inset.left + prefix[q] - prefix[k];
+            const Rect r = is_head ? RectC(inset.left, y, avail_w, ln.h)
+                                   : RectC(nx, y, specs.cx[q], specs.cy[q]);
+            if(q >= keep || rects[q] != r) {
+                rects[q] = r;
+                changed.Add(q);
+            }
+        }
+
+        y += ln.h + gap.cy;
+        k = j;
+    }
+
+    lines.Trim(line);
+    lines.Append(fresh);
+    width = avail_w;
+
+    const int used_h = lines.IsEmpty() ? inset.top : lines.Top().y + lines.Top().h;
+    virtualLen = max(f.AvailH(), used_h + inset.bottom);
+    return virtualLen;
+}
+
+} // namespace Upp
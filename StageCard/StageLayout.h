@@ -0,0 +1,166 @@
+#ifndef _StageCard_StageLayout_h_
+#define _StageCard_StageLayout_h_
+
+#include <Core/Core.h>
+
+namespace Upp {
+
+/*
+================================================================================
+StageLayout — headless geometry for StageCard
+================================================================================
+
+The stack and wrap layouts of StageCard, without any Ctrl: item specs
+(natural sizes, expand weights, flags) plus a frame (viewport, insets,
+gaps) go in, rects and the content length come out. StageCard gathers the
+specs from its children and commits the rects; tests, benchmarks or a
+worker thread can call the solver directly. StageMeasureSizes fills the
+specs of data-driven items on the CoWork pool; StageRectIndex answers
+"which item is under this point / inside this rect" for painted items.
+
+  StageSpecs specs;
+  specs.Add(120, 30);                  // fixed tile / row
+  specs.Add(0, 40, 1);                 // expand row, weight 1
+  StageFrame f;
+  f.viewport = Size(400, 300);
+  f.gap      = Size(6, 6);
+  StageGeometry g;
+  StageSolveStack(specs, true, f, g);  // g.rects[i], g.virtualLen
+
+Coordinates are content-layer coordinates (inset included). virtualLen is
+the scrollable main-axis length, never less than the viewport.
+*/
+
+// Item specs, struct-of-arrays
+struct StageSpecs {
+    enum {
+        SPACER = 0x01,  // stack: takes space, no control
+        BREAK  = 0x02,  // wrap: full-width line of its own (section header)
+    };
+
+    Vector<int>  cx, cy;   // natural size
+    Vector<int>  weight;   // stack: expand weight, 0 = fixed
+    Vector<byte> flags;
+
+    void Clear()                  { cx.SetCount(0); cy.SetCount(0); weight.SetCount(0); flags.SetCount(0); }
+    void Reserve(int n)           { cx.Reserve(n); cy.Reserve(n); weight.Reserve(n); flags.Reserve(n); }
+    void Add(int w, int h, int wt = 0, byte f = 0) { cx.Add(w); cy.Add(h); weight.Add(max(0, wt)); flags.Add(f); }
+    int  GetCount() const         { return cx.GetCount(); }
+    int  GetAlloc() const         { return cx.GetAlloc(); }
+};
+
+// Where the items go
+struct StageFrame {
+    Size viewport = Size(0, 0);  // content pane size
+    Rect inset    = Rect(0, 0, 0, 0);
+    Size gap      = Size(0, 0);
+
+    int  AvailW() const { return max(0, viewport.cx - inset.left - inset.right); }
+    int  AvailH() const { return max(0, viewport.cy - inset.top - inset.bottom); }
+};
+
+struct StageGeometry {
+    Vector<Rect> rects;           // one per spec
+    int          virtualLen = 0;  // scrollable length along the main axis
+};
+
+// Stack along one axis. Non-expand items keep their natural main-axis size;
+// expand items start from a common baseline (the largest expand natural)
+// and share what is left of the viewport by weight. Cross axis stretches.
+void StageSolveStack(const StageSpecs& specs, bool vertical, const StageFrame& f, StageGeometry& out);
+
+// Ragged wrap, one shot (see StageWrapSolver for repeated passes)
+void StageSolveWrap(const StageSpecs& specs, const StageFrame& f, StageGeometry& out);
+
+// Natural sizes of data items [from, to) into out[from, to) (out already
+// sized). With parallel, large ranges are split over the CoWork pool, so
+// size_of must be thread safe (text extents, image sizes).
+void StageMeasureSizes(const Function<Size (int)>& size_of, int from, int to,
+                       Vector<Size>& out, bool parallel);
+
+// Process-wide LRU of solved geometry, shared by every card (thread safe).
+// Entries are found by a 64-bit hash of (specs, frame, layout kind) and
+// keep a copy of those inputs; a hit is only trusted when they compare
+// equal, so a hash collision costs a solve, never wrong rects. The caller
+// has already gathered the specs, and checking a hit is linear like the
+// stack solve itself: the memo pays off where a solve is dear or one
+// configuration is solved again and again (headless callers, benchmarks),
+// not per card layout, hence StageCard leaves it off by default.
+struct StageLayoutMemo {
+    enum { STACK_V = 1, STACK_H = 2, WRAP = 3 };
+
+    static uint64 Key(const StageSpecs& specs, const StageFrame& f, int kind);
+    static bool   Get(const StageSpecs& specs, const StageFrame& f, int kind, StageGeometry& out); // copies into out
+    static void   Put(const StageSpecs& specs, const StageFrame& f, int kind, const StageGeometry& g);
+    static void   SetCapacity(int entries);              // default 32
+    static void   Clear();
+    static int64  GetAlloc();                            // bytes reserved by the entries
+    static int64  GetHits();
+    static int64  GetMisses();
+};
+
+// StageSolveStack through StageLayoutMemo
+void StageSolveStackMemo(const StageSpecs& specs, bool vertical, const StageFrame& f, StageGeometry& out);
+
+// Ragged wrap that remembers its lines. Given how many leading specs are
+// unchanged since the previous Solve (keep), it restarts at the line
+// holding the first changed tile when the width is the same, and reports
+// only the tiles whose rect differs (or that are new) in `changed`.
+class StageWrapSolver {
+public:
+    int                 Solve(const StageSpecs& specs, int keep, const StageFrame& f, Vector<int>& changed);
+    const Vector<Rect>& GetRects() const      { return rects; }
+    int                 GetVirtualLen() const { return virtualLen; }
+    int                 GetAlloc() const;     // bytes reserved, for allocation accounting
+    void                Clear();
+
+private:
+    struct Line : Moveable<Line> {
+        int first = 0;  // spec index of the line head
+        int count = 0;
+        int y     = 0;
+        int h     = 0;
+    };
+    Vector<int>  prefix;     // prefix[k] = sum of (cx + gap.cx) over specs [0, k)
+    Vector<int>  heads;      // BREAK spec indices
+    Vector<Line> lines, fresh;
+    Vector<Rect> rects;
+    int          width = -1; // avail width the lines were broken for
+    Rect         inset = Null;
+    Size         gap   = Null;
+    int          virtualLen = 0;
+};
+
+// Uniform-grid spatial index over a fixed set of rects (hit-testing and
+// paint culling for owner-drawn items). Cells are stored CSR style, one
+// int per (rect, overlapped cell), so 100k tiles cost a few hundred KB.
+// Find() scans one cell; Query() reports each rect once, in index order.
+// Append() adds rects below or inside the grid by rewriting only the cells
+// from the first one they touch (row-major), so appending a row of tiles
+// at the bottom costs about that row; anything else rebuilds.
+class StageRectIndex {
+public:
+    void                Build(Vector<Rect>&& rects, int cell = 0); // cell <= 0: from the average rect size
+    void                Append(const Vector<Rect>& more);
+    int                 Find(Point p) const;                      // last rect containing p, -1 = none
+    void                Query(const Rect& r, Vector<int>& out) const;
+    const Vector<Rect>& GetRects() const  { return rects; }
+    const Rect&         operator[](int i) const { return rects[i]; }
+    int                 GetCount() const  { return rects.GetCount(); }
+    int                 GetAlloc() const; // bytes reserved, for allocation accounting
+    void                Clear();
+
+private:
+    Vector<Rect> rects;
+    Vector<int>  start;   // start[c] .. start[c + 1]: slice of ids in cell c
+    Vector<int>  ids;
+    Rect         bounds = Rect(0, 0, 0, 0);
+    int          cell = 1, cols = 0, rows = 0;
+    int          want = 0;  // cell size asked of Build
+
+    int CellX(int x) const { return clamp((x - bounds.left) / cell, 0, cols - 1); }
+    int CellY(int y) const { return clamp((y - bounds.top) / cell, 0, rows - 1); }
+};
+
+} // namespace Upp
+#endif
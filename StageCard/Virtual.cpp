@@ -0,0 +1,392 @@
+#include "StageCard.h"
+
+namespace Upp {
+
+// -------------------------- Virtual wrap --------------------------
+StageCard& StageCard::SetVirtualWrap(int count, Function<Size (int)> size_of,
+                                     Function<Ctrl *()> create, Function<void (Ctrl&, int)> bind) {
+    ClearChildren(contentLayer);
+    items.Clear();
+    ClearOwned(); // also stops a running Populate()
+    ResetLayoutCaches();
+    ResetPainted();
+    VirtualState& v = OwnVirtual();
+    v.pool.Clear();
+    v.bound.Clear();
+    v.ClearGeometry();
+
+    v.count  = max(0, count);
+    v.size   = pick(size_of);
+    v.create = pick(create);
+    v.bind   = pick(bind);
+    v.stack  = false;
+
+    mode = ContentMode::STACK;
+    dir  = Direction::H;
+    wrap = true;
+    Relayout();
+    return *this;
+}
+
+StageCard& StageCard::SetVirtualStack(int count, int estimate_h,
+                                      Function<Ctrl *()> create, Function<void (Ctrl&, int)> bind) {
+    ClearChildren(contentLayer);
+    items.Clear();
+    ClearOwned(); // also stops a running Populate()
+    ResetLayoutCaches();
+    ResetPainted();
+    VirtualState& v = OwnVirtual();
+    v.pool.Clear();
+    v.bound.Clear();
+    v.ClearGeometry();
+
+    v.count    = max(0, count);
+    v.size.Clear();
+    v.create   = pick(create);
+    v.bind     = pick(bind);
+    v.stack    = true;
+    v.estimate = max(1, estimate_h);
+    RebuildVirtualRows();
+
+    mode = ContentMode::STACK;
+    dir  = Direction::V;
+    wrap = false;
+    Relayout();
+    return *this;
+}
+
+// Row extents (height + gap) for rows [0, count): measured rows keep their
+// height, new rows start at the estimate. O(n) tree build.
+void StageCard::RebuildVirtualRows() {
+    VirtualState& v = *virt;
+    const int old = v.rowH.GetCount();
+    v.rowH.SetCount(v.count);
+    v.rowKnown.SetCount(v.count);
+    for(int i = old; i < v.count; ++i) {
+        v.rowH[i]     = v.estimate + contentGap.cy;
+        v.rowKnown[i] = 0;
+    }
+    v.tree.Build(v.rowH);
+}
+
+StageCard& StageCard::SetVirtualCount(int count) {
+    count = max(0, count);
+    VirtualState& v = OwnVirtual();
+    if(count < v.count) {
+        v.sizes.Trim(min(v.sizes.GetCount(), count));
+        v.width = -1; // tail lines are gone
+    }
+    v.count = count;
+    if(v.stack)
+        RebuildVirtualRows();
+    Reflow();
+    return *this;
+}
+
+StageCard& StageCard::RefreshVirtual() {
+    if(IsPainted()) {
+        if(painted->pane)
+            painted->pane->Refresh();
+        return *this;
+    }
+    if(!virt)
+        return *this;
+    VirtualState& v = *virt;
+    for(int s = 0; s < v.pool.GetCount(); ++s)
+        if(v.bound[s] >= 0) {
+            v.bind(v.pool[s], v.bound[s]);
+            if(v.stack)
+                v.rowKnown[v.bound[s]] = 0; // re-measure on next sync
+        }
+    SyncVirtual();
+    return *this;
+}
+
+StageCard& StageCard::ClearVirtual() {
+    CancelPopulate();
+    ResetPainted();
+    if(virt) { // kept, with its overscan and parallel settings
+        VirtualState& v = *virt;
+        v.pool.Clear(); // owned controls remove themselves from contentLayer
+        v.bound.Clear();
+        v.ClearGeometry();
+        v.count = 0;
+        v.stack = false;
+        v.size.Clear();
+        v.create.Clear();
+        v.bind.Clear();
+    }
+    Relayout();
+    return *this;
+}
+
+// Geometry of all `count` items without touching any control: uniform cells
+// are arithmetic, variable sizes are cached once and broken into lines with
+// prefix sums (only when the width changes).
+void StageCard::LayoutVirtualWrap(const Rect& inner) {
+    Rect eff = EffectiveContentInset();
+    const int avail_w = max(0, inner.GetWidth()  - eff.left - eff.right);
+    const int inner_h = max(0, inner.GetHeight() - eff.top  - eff.bottom);
+
+    VirtualState& v = *virt;
+    if(v.inset != eff || v.gap != contentGap) {
+        v.inset = eff;
+        v.gap   = contentGap;
+        v.width = -1;
+    }
+
+    int used_h = 0;
+    if(!v.size) {
+        const Size cell = wrapItem.cx > 0 && wrapItem.cy > 0 ? wrapItem : Size(DPI(48), DPI(48));
+        v.cols = max(1, (avail_w + contentGap.cx) / (cell.cx + contentGap.cx));
+        const int rows = (v.count + v.cols - 1) / v.cols;
+        used_h = rows > 0 ? rows * (cell.cy + contentGap.cy) - contentGap.cy : 0;
+    } else {
+        if(v.sizes.GetCount() < v.count) {
+            const int from = v.sizes.GetCount();
+            v.sizes.SetCount(v.count);
+            StageMeasureSizes(v.size, from, v.count, v.sizes, v.parallel);
+            v.width = -1;
+        }
+        if(v.width != avail_w) {
+            const int n = v.count;
+            v.prefix.SetCount(n + 1);
+            v.prefix[0] = 0;
+            for(int i = 0; i < n; ++i)
+                v.prefix[i + 1] = v.prefix[i] + v.sizes[i].cx + contentGap.cx;
+
+            v.lines.SetCount(0);
+            int y = eff.top;
+            for(int k = 0; k < n; ) {
+                const int limit = v.prefix[k] + avail_w + contentGap.cx;
+                int lo = k + 1, hi = n;
+                while(lo < hi) {
+                    const int mid = (lo + hi + 1) / 2;
+                    if(v.prefix[mid] <= limit) lo = mid;
+                    else                       hi = mid - 1;
+                }
+                WrapLine& ln = v.lines.Add();
+                ln.first = k;
+                ln.count = lo - k;
+                ln.y     = y;
+                for(int q = k; q < lo; ++q)
+                    ln.h = max(ln.h, v.sizes[q].cy);
+                y += ln.h + contentGap.cy;
+                k = lo;
+            }
+            v.width = avail_w;
+        }
+        used_h = v.lines.IsEmpty() ? 0 : v.lines.Top().y + v.lines.Top().h - eff.top;
+    }
+
+    virtualLen = max(inner_h, eff.top + used_h + eff.bottom);
+    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+}
+
+void StageCard::LayoutVirtualStack(const Rect& inner) {
+    Rect eff = EffectiveContentInset();
+    const int inner_h = max(0, inner.GetHeight() - eff.top - eff.bottom);
+
+    VirtualState& v = *virt;
+    if(v.gap != contentGap) {
+        v.gap = contentGap;
+        v.rowH.Clear();
+        v.rowKnown.Clear();
+        RebuildVirtualRows();
+    }
+    v.inset = eff;
+    v.width = max(0, inner.GetWidth() - eff.left - eff.right);
+
+    const int total = v.tree.Total() - (v.count > 0 ? contentGap.cy : 0);
+    virtualLen = max(inner_h, eff.top + total + eff.bottom);
+    contentLayer.SetRect(0, -scroll_y, inner.GetWidth(), virtualLen);
+}
+
+Rect StageCard::VirtualItemRect(int i) const {
+    const VirtualState& v = *virt;
+    if(v.stack)
+        return RectC(v.inset.left, v.inset.top + v.tree.Prefix(i),
+                     v.width, v.rowH[i] - contentGap.cy);
+    if(!v.size) {
+        const Size cell = wrapItem.cx > 0 && wrapItem.cy > 0 ? wrapItem : Size(DPI(48), DPI(48));
+        const int  cols = max(1, v.cols);
+        return RectC(v.inset.left + (i % cols) * (cell.cx + contentGap.cx),
+                     v.inset.top  + (i / cols) * (cell.cy + contentGap.cy),
+                     cell.cx, cell.cy);
+    }
+    // line holding i: last line with first <= i
+    int lo = 0, hi = v.lines.GetCount() - 1;
+    while(lo < hi) {
+        const int mid = (lo + hi + 1) / 2;
+        if(v.lines[mid].first <= i) lo = mid;
+        else                        hi = mid - 1;
+    }
+    const WrapLine& ln = v.lines[lo];
+    return RectC(v.inset.left + v.prefix[i] - v.prefix[ln.first], ln.y,
+                 v.sizes[i].cx, v.sizes[i].cy);
+}
+
+// Items [first, last) whose rows intersect [top, bottom) in layer coordinates
+void StageCard::GetVirtualRange(int top, int bottom, int& first, int& last) const {
+    const VirtualState& v = *virt;
+    first = last = 0;
+    if(v.count <= 0 || bottom <= top)
+        return;
+    if(v.stack) {
+        first = min(v.count, v.tree.Find(max(0, top - v.inset.top)));
+        last  = min(v.count, v.tree.Find(max(0, bottom - v.inset.top)) + 1);
+        return;
+    }
+    if(!v.size) {
+        const Size cell  = wrapItem.cx > 0 && wrapItem.cy > 0 ? wrapItem : Size(DPI(48), DPI(48));
+        const int  row_h = cell.cy + contentGap.cy;
+        const int  a  = top - v.inset.top - cell.cy;
+        const int  r0 = a < 0 ? 0 : a / row_h + 1;
+        const int  b  = bottom - v.inset.top;
+        if(b <= 0)
+            return;
+        const int  r1 = (b + row_h - 1) / row_h - 1;
+        first = min(v.count, r0 * max(1, v.cols));
+        last  = min(v.count, (r1 + 1) * max(1, v.cols));
+        last  = max(first, last);
+        return;
+    }
+    const int n = v.lines.GetCount();
+    if(n == 0)
+        return;
+    // first line ending below top, first line starting at/after bottom
+    int lo = 0, hi = n;
+    while(lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if(v.lines[mid].y + v.lines[mid].h <= top) lo = mid + 1;
+        else                                      hi = mid;
+    }
+    const int l0 = lo;
+    hi = n;
+    while(lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if(v.lines[mid].y < bottom) lo = mid + 1;
+        else                        hi = mid;
+    }
+    if(l0 >= lo)
+        return;
+    first = v.lines[l0].first;
+    last  = v.lines[lo - 1].first + v.lines[lo - 1].count;
+}
+
+// Bind pooled controls to the items under the viewport. Controls whose item
+// scrolled away are re-bound to newly exposed items; the pool only grows
+// when more items are visible at once than ever before.
+void StageCard::SyncVirtual() {
+    if(!IsVirtual() || virt->syncing)
+        return;
+    if(IsPainted()) {
+        SyncPainted();
+        return;
+    }
+    VirtualState& v = *virt;
+    v.syncing = true;
+
+    // Measured rows move the rows below them: shorter rows pull unbound ones
+    // into view, so bind until the range holds no unmeasured row.
+    bool resized = false;
+    int first, last;
+    while(BindVirtualRange(first, last))
+        resized = true;
+
+    for(int i = first; i < last; ++i) {
+        const int s = v.slotOf[i - first];
+        const Rect r = VirtualItemRect(i);
+        if(v.pool[s].GetRect() != r)
+            v.pool[s].SetRect(r);
+    }
+
+    for(int s : v.spare) {
+        v.bound[s] = -1;
+        v.pool[s].Hide();
+    }
+    v.syncing = false;
+    if(!resized)
+        return;
+    // The scrollbar has to come or go: that is FitScrolled's call (it also
+    // narrows the rows), after the running pass if there is one
+    if(scrollEnabled && (virtualLen > contentPane.GetSize().cy) != IsScrollShown()) {
+        if(inLayout)
+            v.refit = true;
+        else
+            Relayout();
+    }
+    ContentChanged(); // measured rows changed the total height
+}
+
+// One bind pass over [first, last) of the current geometry; true when
+// measured stack rows changed the heights (the range has to be re-queried).
+bool StageCard::BindVirtualRange(int& first, int& last) {
+    VirtualState& v = *virt;
+    const int page = contentPane.GetSize().cy;
+    GetVirtualRange(scroll_y - v.overscan, scroll_y + page + v.overscan, first, last);
+
+    v.slotOf.SetCount(last - first);
+    for(int& s : v.slotOf)
+        s = -1;
+    v.spare.SetCount(0);
+    for(int s = 0; s < v.pool.GetCount(); ++s) {
+        const int i = v.bound[s];
+        if(i >= first && i < last)
+            v.slotOf[i - first] = s;
+        else
+            v.spare.Add(s);
+    }
+
+    for(int i = first; i < last; ++i) {
+        int s = v.slotOf[i - first];
+        if(s < 0) {
+            if(v.spare.GetCount()) {
+                s = v.spare.Pop();
+            } else {
+                s = v.pool.GetCount();
+                contentLayer.Add(v.pool.Add(v.create()));
+                v.bound.Add(-1);
+            }
+            v.bound[s] = i;
+            v.bind(v.pool[s], i);
+            v.pool[s].Show();
+        }
+        v.slotOf[i - first] = s;
+    }
+
+    if(!v.stack)
+        return false;
+
+    // Stack rows: replace estimates by measured heights. A row that starts
+    // above the viewport moves everything below it, so scroll_y follows the
+    // correction and the visible rows stay put.
+    int shift = 0;
+    bool grew = false;
+    for(int i = first; i < last; ++i) {
+        if(v.rowKnown[i]) continue;
+        const int h = v.pool[v.slotOf[i - first]].GetMinSize().cy + contentGap.cy;
+        const int delta = h - v.rowH[i];
+        v.rowKnown[i] = 1;
+        if(!delta) continue;
+        if(v.inset.top + v.tree.Prefix(i) < scroll_y)
+            shift += delta;
+        v.rowH[i] = h;
+        v.tree.Add(i, delta);
+        grew = true;
+    }
+    if(!grew)
+        return false;
+    const int total = v.tree.Total() - (v.count > 0 ? contentGap.cy : 0);
+    const int inner_h = max(0, page - v.inset.top - v.inset.bottom);
+    virtualLen = max(inner_h, v.inset.top + total + v.inset.bottom);
+    scroll_y = clamp(scroll_y + shift, 0, max(0, virtualLen - page));
+    contentLayer.SetRect(0, -scroll_y, contentLayer.GetRect().GetWidth(), virtualLen);
+    if(IsScrollShown()) {
+        vbar->SetTotal(virtualLen);
+        vbar->Set(scroll_y);
+    }
+    return true;
+}
+
+} // namespace Upp
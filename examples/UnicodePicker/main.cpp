@@ -494,9 +494,11 @@ public:
         Image sample = MakeDragSample();
         DoDragAndDrop(InternalClip(*this, payload.flavor), sample, DND_COPY);
     }
-    void LeftDown(Point p, dword k) override {
-        if(mode == DROPPED && WhenRemove) WhenRemove();
-        Button::LeftDown(p, k);
+    // Bin tiles go on click (release), so a press can still start a drag-reorder
+    void LeftUp(Point p, dword k) override {
+        Button::LeftUp(p, k);
+        if(mode == DROPPED && WhenRemove && Rect(GetSize()).Contains(p))
+            WhenRemove(); // may destroy this tile, keep it last
     }
 
     // paint
@@ -788,13 +790,21 @@ public:
             .SetContentCornerRadius(DPI(10))
             .SetContentFrameThickness(2);
 
-        StackH(); SetWrap(); EnableContentScroll(true); EnableContentClampToPane(true);
+        StackH(); SetWrap(); WrapItemSize(tileSizes.cx, tileSizes.cy);
+        EnableContentScroll(true); EnableContentClampToPane(true);
+        EnableDragReorder();
+        WhenReorder = [=](int from, int to) { // tiles already moved, follow with the data
+            SymbolItem s = items[from];
+            items.Remove(from);
+            items.Insert(to, s);
+            FireListChanged();
+        };
         SetContentInset(DPI(8), DPI(8), DPI(8), DPI(8));
         SetContentGap(DPI(4), DPI(4));
     }
 
-    DropBinCard& SetTileSize(Size s)      { tileSizes = s;  Reflow(); return *this; }
-    DropBinCard& SetTileSize(int w,int h) { tileSizes = Size(w,h); Reflow(); return *this; }
+    DropBinCard& SetTileSize(Size s)      { tileSizes = s;  RebuildBin(); return *this; }
+    DropBinCard& SetTileSize(int w,int h) { tileSizes = Size(w,h); RebuildBin(); return *this; }
 
     const Vector<SymbolItem>& GetSymbols() const { return items; }
 
@@ -811,6 +821,10 @@ public:
         if(WhenRemoved) WhenRemoved(removed);
         RebuildTiles(); FireListChanged();
     }
+    void RemoveSymbol(const String& charCode) {
+        for(int i = 0; i < items.GetCount(); ++i)
+            if(items[i].charCode == charCode) { RemoveIndex(i); return; }
+    }
     void ClearAll() { items.Clear(); RebuildTiles(); FireListChanged(); }
 
     void DragAndDrop(Point, PasteClip& d) override {
@@ -848,31 +862,36 @@ public:
 
 private:
     Vector<SymbolItem>        items;
-    Array<DragBadgeButton>    tiles;
 
     void FireListChanged() { if(WhenListChanged) WhenListChanged(); }
 
+    // Tiles are keyed by charCode: only added / removed symbols touch a control
     void RebuildTiles() {
-        for (int i = 0; i < tiles.GetCount(); ++i) tiles[i].Remove();
-        tiles.Clear();
-
-        for (int i = 0; i < items.GetCount(); ++i) {
-            DragBadgeButton& t = tiles.Create();
-            SetupSymbolTile(t, items[i])
-                .SetMode(DragBadgeButton::DROPPED)
-                .SetRadius(DPI(5))
-                .SetStroke(1)
-                .EnableDashed(false)
-                .EnableFill(true);
-            t.WhenRemove = THISBACK1(RemoveIndex, i);
-            AddFixed(t, tileSizes.cx, tileSizes.cy);
-        }
-        Layout(); Refresh();
+        Vector<String> keys;
+        for(const SymbolItem& s : items)
+            keys.Add(s.charCode);
+        SetItems(keys,
+            [](const String&) -> Ctrl * {
+                DragBadgeButton *t = new DragBadgeButton;
+                t->SetMode(DragBadgeButton::DROPPED)
+                  .SetRadius(DPI(5))
+                  .SetStroke(1)
+                  .EnableDashed(false)
+                  .EnableFill(true);
+                return t;
+            },
+            [=](Ctrl& c, int i) {
+                DragBadgeButton& t = static_cast<DragBadgeButton&>(c);
+                const String code = items[i].charCode;
+                SetupSymbolTile(t, items[i]);
+                t.WhenRemove = [=] { RemoveSymbol(code); };
+            });
+        Refresh();
     }
 
-    void Reflow() {
-        for(int i = 0; i < tiles.GetCount(); ++i) tiles[i].SetMinSize(tileSizes);
-        Layout(); Refresh();
+    void RebuildBin() {
+        WrapItemSize(tileSizes.cx, tileSizes.cy);
+        Refresh();
     }
 };
 
@@ -901,7 +920,6 @@ public:
     Splitter       leftSplit;
 
     // Content controls
-    Array<DragBadgeButton> symbolTiles;
     Array<DragBadgeButton> categoryButtons;
     DocEdit        codeOutput;
     Option         hexMode;
@@ -912,6 +930,13 @@ public:
     Color          appBg     = SColorPaper();
     Size           tileSizes = Size(70, 50);
 
+    // Painted symbol tiles: look of the current theme, faces cached per state
+    DragBadgeButton::Palette tilePal;
+    Image          tileFace[DragBadgeButton::ST_COUNT];
+    Size           tileFaceSize = Size(0, 0);
+    Font           tileFont      = StdFont().Height(DPI(8));
+    Font           tileBadgeFont = StdFont().Height(DPI(17));
+
     // small layout cursor for header row
     int colStart = DPI(8), colPad = DPI(4), colX = DPI(0);
     int ColPos(int width, bool reset=false) { if(reset) colX=colStart; int cur=colX; colX += DPI(width) + colPad; return cur; }
@@ -957,7 +982,7 @@ public:
         categoryCard.EnableHeaderFill(false).EnableCardFill(false).EnableCardFrame(false)
                     .EnableContentFill(false).EnableContentFrame(false)
                     .EnableContentClampToPane(true).EnableContentScroll(true)
-                    .StackH().SetWrap()
+                    .StackH().SetWrap().WrapItemSize(150, 25)
                     .SetContentInset(DPI(4), DPI(4), DPI(4), DPI(4))
                     .SetContentGap(DPI(6), DPI(6));
         Add(categoryCard.HSizePos(DPI(8), DPI(8)).TopPos(DPI(72), DPI(130)));
@@ -984,9 +1009,10 @@ public:
                 .EnableContentFill(true).EnableContentFrame(false)
                 .SetContentCornerRadius(DPI(10)).SetContentFrameThickness(0)
                 .EnableContentScroll(true).EnableContentClampToPane(true)
-                .StackH().SetWrap()
+                .StackH().SetWrap().WrapItemSize(tileSizes.cx, tileSizes.cy)
                 .SetContentInset(DPI(6), DPI(6), DPI(6), DPI(6))
                 .SetContentGap(DPI(6), DPI(6));
+        itemsCard.WhenItemDrag = THISBACK(DragSymbol);
 
         // Bin card (dashed frame enabled inside ApplyStyleId via a clone style)
         binCard.SetTileSize(tileSizes).WhenListChanged = THISBACK(UpdateCodeOutput);
@@ -1083,10 +1109,7 @@ public:
         }
 
         // Symbol tiles
-        for(int i=0;i<symbolTiles.GetCount();++i) {
-            symbolTiles[i].SetBaseColors(T.tile_face, T.tile_border, T.tile_ink);
-            symbolTiles[i].SetFont( StdFont().Height(DPI(8)) );
-        }
+        StyleSymbolTiles();
         // Style selector itself
         if(theme_id == 1) { // Midnight
             styleDrop.SetBgColor(Gray()).SetTextColor(Black());
@@ -1106,22 +1129,77 @@ public:
         UpdateSymbolGrid();
     }
 
-    void UpdateSymbolGrid() {
-        for (int i = 0; i < symbolTiles.GetCount(); ++i) symbolTiles[i].Remove();
-        symbolTiles.Clear();
-
-        const SymbolCategory* activeCat = nullptr;
-        for (const auto& cat : allCategories) if(cat.key == activeCategoryKey) { activeCat = &cat; break; }
-        if(!activeCat) return;
-
-        for (int i = 0; i < activeCat->symbols.GetCount(); ++i) {
-            const auto& item = activeCat->symbols[i];
-            DragBadgeButton& tile = symbolTiles.Create();
-            SetupSymbolTile(tile, item).SetMode(DragBadgeButton::DRAGABLE);
-            itemsCard.AddFixed(tile, tileSizes.cx, tileSizes.cy);
+    void StyleSymbolTiles() {
+        const int theme_count = (int)(sizeof(THEMES)/sizeof(THEMES[0]));
+        const AppTheme& T = THEMES[clamp(theme_id,0,theme_count-1)];
+        DragBadgeButton b; // same per-state derivation as the button tiles
+        b.SetBaseColors(T.tile_face, T.tile_border, T.tile_ink);
+        tilePal = b.GetPalette();
+        tileFaceSize = Size(0, 0);
+        itemsCard.RefreshVirtual();
+    }
+
+    const SymbolCategory *ActiveCategory() const {
+        for (const auto& cat : allCategories) if(cat.key == activeCategoryKey) return &cat;
+        return nullptr;
+    }
+
+    // Rounded face + border of one state, painted once per tile size
+    const Image& TileFace(int st, Size sz) {
+        if(sz != tileFaceSize) {
+            for(Image& m : tileFace) m = Image();
+            tileFaceSize = sz;
         }
-        itemsCard.Layout();
-        ApplyStyleId(theme_id); // restyle new tiles
+        Image& m = tileFace[st];
+        if(m.IsEmpty() && sz.cx > 0 && sz.cy > 0) {
+            Color face = tilePal.face[st];
+            if(st == DragBadgeButton::ST_HOT)
+                face = Blend(face, White(), 40);
+            ImageBuffer ib(sz);
+            Fill(~ib, RGBAZero(), ib.GetLength());
+            {
+                BufferPainter p(ib, MODE_ANTIALIASED);
+                p.Begin();
+                p.RoundedRectangle(0.5, 0.5, sz.cx - 1, sz.cy - 1, DPI(8));
+                p.Fill(face);
+                p.Stroke(1, tilePal.border[st]);
+                p.End();
+            }
+            m = ib;
+        }
+        return m;
+    }
+
+    // One symbol, drawn like a DragBadgeButton in ICON_CENTER_TEXT_BOTTOM
+    void PaintSymbolTile(Draw& w, const Rect& r, int i, int st) {
+        const SymbolCategory *cat = ActiveCategory();
+        if(!cat || i >= cat->symbols.GetCount()) return;
+        const SymbolItem& s = cat->symbols[i];
+        w.DrawImage(r.left, r.top, TileFace(st, r.GetSize()));
+        const Rect c = r.Deflated(DPI(6), DPI(4));
+        const Color ink = tilePal.ink[st];
+        const Size gsz = GetTextSize(s.charCode, tileBadgeFont);
+        const Size ts  = GetTextSize(s.name, tileFont);
+        w.DrawText(c.left + (c.GetWidth() - gsz.cx)/2, c.top + (c.GetHeight() - (gsz.cy + DPI(4) + ts.cy))/2,
+                   s.charCode, tileBadgeFont, ink);
+        w.DrawText(c.left + (c.GetWidth() - ts.cx)/2, c.bottom - ts.cy, s.name, tileFont, ink);
+    }
+
+    // Symbols are plain records painted by the card; no control per tile
+    void UpdateSymbolGrid() {
+        const SymbolCategory* activeCat = ActiveCategory();
+        itemsCard.SetPaintedItems(activeCat ? activeCat->symbols.GetCount() : 0, Null,
+            [=](Draw& w, const Rect& r, int i, int st) { PaintSymbolTile(w, r, i, st); });
+    }
+
+    // A painted tile has no Ctrl to drag: a transient button carries the
+    // payload the bin expects for the length of the (modal) drag.
+    void DragSymbol(int i) {
+        const SymbolCategory *cat = ActiveCategory();
+        if(!cat || i >= cat->symbols.GetCount()) return;
+        DragBadgeButton carrier;
+        SetupSymbolTile(carrier, cat->symbols[i]);
+        itemsCard.DoDragAndDrop(InternalClip(carrier, "symbol"), itemsCard.GetPaintedItemImage(i), DND_COPY);
     }
 
     void UpdateCodeOutput() {
@@ -0,0 +1,78 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// A card that scrolls lays out at the narrowed width only, so the
+// incremental caches see one width and an append resumes from the tail
+// instead of placing every tile again (twice).
+static int64 AppendPlaced(StageCard& card, Array<Button>& tiles)
+{
+    card.ResetLayoutStats();
+    card.AddFixed(tiles.Add(), DPI(40));
+    card.Layout();
+    return card.GetLayoutStats().placed;
+}
+
+static void CheckWrap()
+{
+    const int N = 300;
+    StageCard card;
+    card.SetStack(StageCard::StackMode::STACKH).SetWrap();
+    Array<Button> tiles;
+    for(int i = 0; i < N; ++i)
+        card.AddFixed(tiles.Add(), DPI(40));
+    card.SetRect(0, 0, DPI(300), DPI(200)); // overflows: the bar is shown
+    card.Layout();
+
+    const int64 placed = AppendPlaced(card, tiles);
+    ASSERT(placed >= 1 && placed < 20); // the tail line, not N + 1 tiles
+    ASSERT(tiles.Top().GetRect().top > tiles[0].GetRect().top);
+    RLOG("wrap: " << placed << " placed");
+}
+
+// Uniform cells: the column count is what the narrowed width holds; the
+// full-width pass used to fit one more and reset the placed count.
+static void CheckUniform()
+{
+    const int N = 300;
+    StageCard card;
+    card.SetStack(StageCard::StackMode::STACKH).SetWrap().WrapItemSize(DPI(40), DPI(40));
+    Array<Button> tiles;
+    for(int i = 0; i < N; ++i)
+        card.AddFixed(tiles.Add(), DPI(40));
+    card.SetRect(0, 0, DPI(300), DPI(200));
+    card.Layout();
+
+    const int64 placed = AppendPlaced(card, tiles);
+    ASSERT(placed == 1);
+    RLOG("uniform wrap: " << placed << " placed");
+}
+
+// Columns follow the width here, so a full-width pass would also change
+// the column count and restart the heap.
+static void CheckMasonry()
+{
+    const int N = 300;
+    StageCard card;
+    card.SetStackMasonry().MasonryColumnWidth(DPI(60));
+    Array<Button> tiles;
+    for(int i = 0; i < N; ++i)
+        card.AddFixed(tiles.Add(), DPI(30) + DPI(10) * (i % 4));
+    card.SetRect(0, 0, DPI(300), DPI(200));
+    card.Layout();
+
+    const Rect first = tiles[0].GetRect();
+    const int64 placed = AppendPlaced(card, tiles);
+    ASSERT(placed == 1); // the new tile only
+    ASSERT(tiles[0].GetRect() == first);
+    RLOG("masonry: " << placed << " placed");
+}
+
+GUI_APP_MAIN
+{
+    CheckWrap();
+    CheckUniform();
+    CheckMasonry();
+    RLOG("StageAppendTest: OK");
+}
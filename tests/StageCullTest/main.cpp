@@ -0,0 +1,34 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// Culled controls are out of the content layer while off screen. A scroll,
+// a resize and an append must neither drop them from the items nor leave
+// them detached once culling ends.
+GUI_APP_MAIN
+{
+    const int N = 200;
+    StageCard card;
+    card.SetStack(StageCard::StackMode::STACKV);
+    Array<Button> rows;
+    for(int i = 0; i < N; ++i)
+        card.AddFixed(rows.Add(), DPI(24));
+    card.SetRect(0, 0, DPI(300), DPI(200));
+    card.Layout();
+
+    card.MouseWheel(Point(DPI(10), DPI(10)), -120 * 20, 0); // scroll down, culls the top rows
+    card.SetRect(0, 0, DPI(320), DPI(220));                 // relayout with items culled
+    card.Layout();
+    Button extra;
+    card.AddFixed(extra, DPI(24));
+    ASSERT(card.GetItemCount() == N + 1);
+
+    card.EnableContentCulling(false);
+    Ctrl *layer = extra.GetParent();
+    ASSERT(layer);
+    for(int i = 0; i < N; ++i)
+        ASSERT(rows[i].GetParent() == layer && rows[i].IsShown());
+    ASSERT(card.GetItemCount() == N + 1);
+    RLOG("StageCullTest: OK");
+}
@@ -0,0 +1,48 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// Uniform-wrap cells go to the shown items only: after SetFilter the k-th
+// remaining tile sits in cell k, and the content height counts only them.
+GUI_APP_MAIN
+{
+    const int N = 40, W = DPI(40), G = DPI(4);
+    StageCard card;
+    card.SetStack(StageCard::StackMode::STACKH).SetWrap().WrapItemSize(W, W);
+    card.SetContentInset(0, 0, 0, 0).SetContentGap(G, G);
+    card.EnableContentScroll(false);
+    Array<Button> tiles;
+    Index<const Ctrl *> kept; // every third tile passes the filter
+    for(int i = 0; i < N; ++i) {
+        card.AddFixed(tiles.Add(), W);
+        if(i % 3 == 0)
+            kept.Add(&tiles[i]);
+    }
+    card.SetRect(0, 0, 5 * W + 4 * G, DPI(600));
+    card.Layout();
+    const int cols = card.GetWrapColumns();
+    ASSERT(cols == 5);
+
+    card.SetFilter([&](const Ctrl& c) { return kept.Find(&c) >= 0; });
+    card.Layout();
+
+    const Point o = tiles[0].GetRect().TopLeft();
+    int k = 0;
+    for(int i = 0; i < N; ++i) {
+        if(i % 3) {
+            ASSERT(!tiles[i].IsShown());
+            continue;
+        }
+        const Rect r = tiles[i].GetRect();
+        ASSERT(r.left == o.x + (k % cols) * (W + G));
+        ASSERT(r.top  == o.y + (k / cols) * (W + G));
+        ++k;
+    }
+    ASSERT(card.GetHeightForWidth(card.GetSize().cx) < card.GetSize().cy);
+
+    int first, last;
+    card.GetWrapVisibleRange(first, last);
+    ASSERT(first == 0 && last == N); // everything fits, tile N - 1 is shown
+    RLOG("StageFilterTest: OK");
+}
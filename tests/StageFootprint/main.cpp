@@ -0,0 +1,49 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// Prints sizeof(StageCard) and the heap each card holds, bare and after a
+// 20 row STACKV layout. Only API present since the first release is used,
+// so the same file measures any revision of the package; the figures are
+// logged before the budget checks, which older revisions fail.
+GUI_APP_MAIN
+{
+    const int N = 1000, ROWS = 20;
+
+    RLOG("sizeof(Ctrl)      = " << (int)sizeof(Ctrl));
+    RLOG("sizeof(ScrollBar) = " << (int)sizeof(ScrollBar));
+    RLOG("sizeof(StageCard) = " << (int)sizeof(StageCard));
+
+    // Members besides the card and its two panes: per-mode state is behind
+    // One<>, so what is left inline are the buffers every mode shares
+    const int own = (int)(sizeof(StageCard) - 3 * sizeof(ParentCtrl));
+    RLOG("card members      = " << own);
+
+    Array<Button> rows; // allocated first, so they do not count below
+    for(int i = 0; i < N * ROWS; ++i)
+        rows.Add();
+
+    const int kb0 = MemoryUsedKb();
+    Array<StageCard> cards;
+    for(int i = 0; i < N; ++i)
+        cards.Add();
+    const int kb1 = MemoryUsedKb();
+
+    for(int i = 0; i < N; ++i) {
+        StageCard& c = cards[i];
+        c.SetStack(StageCard::StackMode::STACKV);
+        for(int k = 0; k < ROWS; ++k)
+            c.AddFixed(rows[i * ROWS + k], DPI(24));
+        c.SetRect(0, 0, DPI(300), DPI(200));
+        c.Layout();
+    }
+    const int kb2 = MemoryUsedKb();
+
+    RLOG("bare card, incl. sizeof   = " << (kb1 - kb0) * 1024 / N << " bytes");
+    RLOG("heap added by the layout  = " << (kb2 - kb1) * 1024 / N << " bytes per card ("
+         << ROWS << " rows, 300 x 200, scrolling)");
+
+    ASSERT(own <= 1800);
+    ASSERT((kb1 - kb0) * 1024 / N <= (int)sizeof(StageCard) + 1024);
+}
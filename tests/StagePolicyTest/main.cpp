@@ -0,0 +1,35 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// Every StageCardT<Policy> must come out of its constructor already in the
+// policy's mode: the constructor lays out once through the policy Layout(),
+// whose ASSERT checks mode / wrap / scroll (debug builds).
+template <class P>
+void CheckPolicy(const char *name)
+{
+    StageCardT<P> card;
+    Button b1, b2;
+    card.AddFixed(b1, DPI(40)).AddFixed(b2, DPI(40));
+    card.SetRect(0, 0, DPI(300), DPI(60));
+    card.Layout();
+    ASSERT(card.GetStack() == P::mode);
+    RLOG(name << ": OK");
+}
+
+GUI_APP_MAIN
+{
+    typedef StageCard::StackMode M;
+    CheckPolicy<StagePolicy<M::STACKV>>("STACKV");
+    CheckPolicy<StagePolicy<M::STACKV, false, false>>("STACKV, no scroll");
+    CheckPolicy<StagePolicy<M::STACKH>>("STACKH");
+    CheckPolicy<StagePolicy<M::STACKH, false, false>>("STACKH, no scroll");
+    CheckPolicy<StagePolicy<M::STACKH, true>>("STACKH wrap");
+    CheckPolicy<StagePolicy<M::STACKH, true, false>>("STACKH wrap, no scroll");
+    CheckPolicy<StagePolicy<M::GRID>>("GRID");
+    CheckPolicy<StagePolicy<M::GRID, false, false>>("GRID, no scroll");
+    CheckPolicy<StagePolicy<M::MASONRY>>("MASONRY");
+    CheckPolicy<StagePolicy<M::NONE, false, true, true>>("NONE, vertical");
+    CheckPolicy<StagePolicy<M::NONE, false, false, false>>("NONE, horizontal, no scroll");
+}
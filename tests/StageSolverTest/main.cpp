@@ -0,0 +1,211 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+static StageFrame Frame(int cx, int cy, int gap)
+{
+    StageFrame f;
+    f.viewport = Size(cx, cy);
+    f.gap      = Size(gap, gap);
+    return f;
+}
+
+static bool Same(const Vector<Rect>& a, const Vector<Rect>& b)
+{
+    if(a.GetCount() != b.GetCount())
+        return false;
+    for(int i = 0; i < a.GetCount(); ++i)
+        if(a[i] != b[i])
+            return false;
+    return true;
+}
+
+// Fixed rows keep their size, expand rows start from the largest expand
+// natural (20) and share the rest (300 - 180 = 120) by weight 1 : 3.
+static void CheckStack()
+{
+    StageSpecs sp;
+    sp.Add(0, 30);
+    sp.Add(0, 40);
+    sp.Add(0, 50);
+    sp.Add(0, 20, 1);
+    sp.Add(0, 10, 3);
+    StageGeometry g;
+    StageSolveStack(sp, true, Frame(200, 300, 5), g);
+    ASSERT(g.rects.GetCount() == 5);
+    ASSERT(g.rects[0] == RectC(0,   0, 200,  30));
+    ASSERT(g.rects[1] == RectC(0,  35, 200,  40));
+    ASSERT(g.rects[2] == RectC(0,  80, 200,  50));
+    ASSERT(g.rects[3] == RectC(0, 135, 200,  50));
+    ASSERT(g.rects[4] == RectC(0, 190, 200, 110));
+    ASSERT(g.virtualLen == 300);
+
+    // Horizontal, overflowing: natural widths, scrollable length past the viewport
+    StageSpecs h;
+    for(int i = 0; i < 5; ++i)
+        h.Add(100, 0);
+    StageFrame f = Frame(300, 50, 0);
+    f.inset = Rect(10, 5, 10, 5);
+    StageSolveStack(h, false, f, g);
+    for(int i = 0; i < 5; ++i)
+        ASSERT(g.rects[i] == RectC(10 + 100 * i, 5, 100, 40));
+    ASSERT(g.virtualLen == 520);
+    RLOG("stack: OK");
+}
+
+// 40 px tiles with a 10 px gap: two per 100 px line.
+static void CheckWrap()
+{
+    StageSpecs sp;
+    for(int i = 0; i < 5; ++i)
+        sp.Add(40, 20);
+    StageGeometry g;
+    StageSolveWrap(sp, Frame(100, 50, 10), g);
+    ASSERT(g.rects[0] == RectC( 0,  0, 40, 20));
+    ASSERT(g.rects[1] == RectC(50,  0, 40, 20));
+    ASSERT(g.rects[2] == RectC( 0, 30, 40, 20));
+    ASSERT(g.rects[3] == RectC(50, 30, 40, 20));
+    ASSERT(g.rects[4] == RectC( 0, 60, 40, 20));
+    ASSERT(g.virtualLen == 80);
+
+    // A BREAK spec is a full-width line of its own
+    StageSpecs br;
+    br.Add(40, 20);
+    br.Add(0, 16, 0, StageSpecs::BREAK);
+    br.Add(40, 20);
+    StageSolveWrap(br, Frame(100, 50, 10), g);
+    ASSERT(g.rects[0] == RectC(0,  0,  40, 20));
+    ASSERT(g.rects[1] == RectC(0, 30, 100, 16));
+    ASSERT(g.rects[2] == RectC(0, 56,  40, 20));
+    RLOG("wrap: OK");
+}
+
+// StageWrapSolver must give the one-shot result and report only the tiles
+// whose rect changed.
+static void CheckWrapSolver()
+{
+    const StageFrame f = Frame(100, 50, 10);
+    StageSpecs sp;
+    for(int i = 0; i < 5; ++i)
+        sp.Add(40, 20);
+    StageWrapSolver ws;
+    Vector<int> changed;
+    ws.Solve(sp, 0, f, changed);
+    ASSERT(changed.GetCount() == 5);
+
+    // Append: resumes on the tail line, only the new tile is reported
+    sp.Add(40, 20);
+    const int len = ws.Solve(sp, 5, f, changed);
+    ASSERT(changed.GetCount() == 1 && changed[0] == 5);
+    ASSERT(ws.GetRects()[5] == RectC(50, 60, 40, 20));
+    StageGeometry g;
+    StageSolveWrap(sp, f, g);
+    ASSERT(Same(ws.GetRects(), g.rects) && len == g.virtualLen);
+
+    // Nothing changed: nothing reported
+    ws.Solve(sp, sp.GetCount(), f, changed);
+    ASSERT(changed.IsEmpty());
+
+    // Width change: three per line now; tiles 0 and 1 stay where they were
+    const StageFrame wide = Frame(160, 50, 10);
+    ws.Solve(sp, sp.GetCount(), wide, changed);
+    StageSolveWrap(sp, wide, g);
+    ASSERT(Same(ws.GetRects(), g.rects) && ws.GetVirtualLen() == g.virtualLen);
+    ASSERT(changed.GetCount() == 4 && changed[0] == 2);
+
+    // A wider tile in the middle re-breaks from its line on
+    sp.cx[4] = 150;
+    ws.Solve(sp, 4, wide, changed);
+    StageSolveWrap(sp, wide, g);
+    ASSERT(Same(ws.GetRects(), g.rects));
+    ASSERT(!changed.IsEmpty() && changed[0] >= 3);
+    RLOG("wrap solver: OK");
+}
+
+// StageRectIndex::Append must answer like an index built over all rects
+static void CheckRectIndexAppend()
+{
+    auto Tile = [](int i) { return RectC((i % 7) * 50, (i / 7) * 30, 40 + i % 3 * 20, 20); };
+    StageRectIndex inc;
+    Vector<Rect> r;
+    for(int i = 0; i < 40; ++i)
+        r.Add(Tile(i));
+    inc.Build(pick(r));
+    for(int n = 40; n < 400; ) {
+        Vector<Rect> more;
+        for(int k = 0; k < 1 + n % 13; ++k)
+            more.Add(Tile(n++));
+        inc.Append(more);
+
+        Vector<Rect> all;
+        for(int i = 0; i < n; ++i)
+            all.Add(Tile(i));
+        StageRectIndex full;
+        full.Build(pick(all));
+        ASSERT(inc.GetCount() == n);
+        Vector<int> a, b;
+        for(int y = -10; y < n / 7 * 30 + 40; y += 17)
+            for(int x = -10; x < 420; x += 23) {
+                ASSERT(inc.Find(Point(x, y)) == full.Find(Point(x, y)));
+                inc.Query(RectC(x, y, 61, 45), a);
+                full.Query(RectC(x, y, 61, 45), b);
+                ASSERT(a.GetCount() == b.GetCount());
+                for(int i = 0; i < a.GetCount(); ++i)
+                    ASSERT(a[i] == b[i]);
+            }
+    }
+    RLOG("rect index append: OK");
+}
+
+// Justified rows: every row but the last fills the same width with equal
+// gaps and one height; the last row keeps the target height.
+static void CheckJustified()
+{
+    const int H = DPI(40), G = DPI(4), N = 30;
+    StageCard card;
+    card.SetStack(StageCard::StackMode::STACKH).SetWrap().SetWrapJustified(H);
+    card.SetContentInset(0, 0, 0, 0).SetContentGap(G, G);
+    card.EnableContentScroll(false);
+    Array<Button> tiles;
+    for(int i = 0; i < N; ++i)
+        card.AddFixed(tiles.Add(), DPI(30) + DPI(17) * (i % 4), H);
+    card.SetRect(0, 0, DPI(400), DPI(800));
+    card.Layout();
+
+    int right = -1, rows = 0;
+    for(int a = 0; a < N; ) {
+        const Rect r0 = tiles[a].GetRect();
+        int b = a + 1;
+        while(b < N && tiles[b].GetRect().top == r0.top) {
+            ASSERT(tiles[b].GetRect().left == tiles[b - 1].GetRect().right + G);
+            ASSERT(tiles[b].GetRect().Height() == r0.Height());
+            ++b;
+        }
+        ASSERT(r0.left == 0);
+        if(b < N) {
+            if(right < 0)
+                right = tiles[b - 1].GetRect().right;
+            ASSERT(tiles[b - 1].GetRect().right == right);
+            ASSERT(tiles[b].GetRect().top == r0.bottom + G);
+        }
+        else {
+            ASSERT(r0.Height() == H);
+            ASSERT(tiles[b - 1].GetRect().right <= right);
+        }
+        ++rows;
+        a = b;
+    }
+    ASSERT(rows > 1);
+    RLOG("justified wrap: " << rows << " rows, OK");
+}
+
+GUI_APP_MAIN
+{
+    CheckStack();
+    CheckWrap();
+    CheckWrapSolver();
+    CheckRectIndexAppend();
+    CheckJustified();
+    RLOG("StageSolverTest: OK");
+}
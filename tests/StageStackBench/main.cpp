@@ -0,0 +1,98 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// Before / after for the STACKV sizing pass. "Before" is the pass StageCard
+// ran until the stack layouts moved to struct-of-arrays lanes: one Row
+// record per item (flags, weight, control, natural height), sized and
+// placed in a loop with per-row branches. "After" is StageSolveStack over
+// StageSpecs. Both get prebuilt inputs and write rects; the results must
+// be identical. Build in release mode for meaningful numbers.
+struct Row {
+    bool  spacer;
+    bool  is_expand;
+    int   expand;
+    Ctrl *c;
+    int   nat_h;
+};
+
+static int SolveRows(const Vector<Row>& rows, const StageFrame& f, Vector<Rect>& out)
+{
+    const int inner_w = f.AvailW();
+    const int inner_h = f.AvailH();
+    int natural_fixed = 0, expand_weight = 0, expand_min = 0, expand_count = 0;
+    for(const Row& r : rows)
+        if(r.is_expand) {
+            expand_weight += r.expand;
+            expand_min     = max(expand_min, r.nat_h);
+            expand_count++;
+        }
+        else
+            natural_fixed += r.nat_h;
+
+    const int cnt = rows.GetCount();
+    const int total_gaps = cnt > 0 ? (cnt - 1) * f.gap.cy : 0;
+    int needed = f.inset.top + natural_fixed + f.inset.bottom + total_gaps;
+    if(expand_count > 0)
+        needed += expand_min * expand_count;
+    const int extra = max(0, inner_h - needed);
+
+    out.SetCount(cnt);
+    int y = f.inset.top;
+    for(int i = 0; i < cnt; i++) {
+        int h;
+        if(rows[i].is_expand && expand_weight > 0)
+            h = expand_min + (extra * rows[i].expand) / expand_weight;
+        else
+            h = rows[i].nat_h;
+        out[i] = RectC(f.inset.left, y, inner_w, h);
+        y += h;
+        if(i + 1 < cnt)
+            y += f.gap.cy;
+    }
+    return max(inner_h, needed);
+}
+
+static void Bench(int n, int reps)
+{
+    StageSpecs sp;
+    Vector<Row> rows;
+    for(int i = 0; i < n; ++i) {
+        const int h  = DPI(20) + (i % 7) * DPI(4);
+        const int wt = i % 50 == 0 ? 1 + i % 3 : 0;
+        sp.Add(0, h, wt, 0);
+        rows.Add({ false, wt > 0, wt, nullptr, h });
+    }
+    StageFrame f;
+    f.viewport = Size(DPI(400), DPI(300));
+    f.inset    = Rect(DPI(8), DPI(8), DPI(8), DPI(8));
+    f.gap      = Size(DPI(4), DPI(4));
+
+    Vector<Rect> before;
+    StageGeometry after;
+    int len = 0;
+    int t0 = msecs();
+    for(int r = 0; r < reps; ++r)
+        len = SolveRows(rows, f, before);
+    const int ms_before = msecs(t0);
+    t0 = msecs();
+    for(int r = 0; r < reps; ++r)
+        StageSolveStack(sp, true, f, after);
+    const int ms_after = msecs(t0);
+
+    ASSERT(len == after.virtualLen && before.GetCount() == after.rects.GetCount());
+    for(int i = 0; i < n; ++i)
+        ASSERT(before[i] == after.rects[i]);
+
+    const double items = double(n) * reps;
+    RLOG(Format("%6d items: row records %.2f ns/item, SoA %.2f ns/item",
+                n, ms_before * 1e6 / items, ms_after * 1e6 / items));
+}
+
+GUI_APP_MAIN
+{
+    Bench(50, 200000);
+    Bench(1000, 10000);
+    Bench(100000, 100);
+}
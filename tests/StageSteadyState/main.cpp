@@ -0,0 +1,72 @@
+#include <CtrlLib/CtrlLib.h>
+#include <StageCard/StageCard.h>
+
+using namespace Upp;
+
+// Steady state: once a card has been laid out at a size, further layouts at
+// that size must not resize a layout buffer (LayoutStats::resized), must not
+// leave heap behind (MemoryUsedKb over many passes), stage no rect that did
+// not change and re-measure no header text. Also prints the time per pass.
+static void Check(const char *name, Function<void (StageCard&, Array<Button>&)> setup)
+{
+    const int N = 500, PASSES = 1000;
+    StageCard card;
+    card.SetTitle(name);
+    Array<Button> tiles;
+    for(int i = 0; i < N; ++i)
+        tiles.Add();
+    setup(card, tiles);
+    card.SetRect(0, 0, DPI(400), DPI(300));
+    card.Layout();
+    card.Layout();
+
+    card.ResetLayoutStats();
+    const int kb = MemoryUsedKb();
+    const int t0 = msecs();
+    for(int i = 0; i < PASSES; ++i)
+        card.Layout();
+    const int ms = msecs(t0);
+    const StageCard::LayoutStats& st = card.GetLayoutStats();
+    ASSERT(st.layouts == PASSES);
+    ASSERT(st.resized == 0);
+    ASSERT(st.measures == 0);
+    ASSERT(MemoryUsedKb() == kb);
+    RLOG(name << ": " << ms * 1000 / PASSES << " us per layout, "
+         << st.placed / PASSES << " rects staged per layout");
+}
+
+GUI_APP_MAIN
+{
+    typedef StageCard::StackMode M;
+    Check("STACKV", [](StageCard& c, Array<Button>& t) {
+        c.SetStack(M::STACKV);
+        for(int i = 0; i < t.GetCount(); ++i)
+            c.AddFixed(t[i], DPI(24));
+    });
+    Check("STACKH wrap", [](StageCard& c, Array<Button>& t) {
+        c.SetStack(M::STACKH).SetWrap();
+        for(int i = 0; i < t.GetCount(); ++i)
+            c.AddFixed(t[i], DPI(30) + DPI(10) * (i % 5), DPI(24));
+    });
+    Check("uniform wrap", [](StageCard& c, Array<Button>& t) {
+        c.SetStack(M::STACKH).SetWrap().WrapItemSize(DPI(40), DPI(40));
+        for(int i = 0; i < t.GetCount(); ++i)
+            c.AddFixed(t[i], DPI(40));
+    });
+    Check("justified wrap", [](StageCard& c, Array<Button>& t) {
+        c.SetStack(M::STACKH).SetWrap().SetWrapJustified(DPI(40));
+        for(int i = 0; i < t.GetCount(); ++i)
+            c.AddFixed(t[i], DPI(30) + DPI(10) * (i % 5), DPI(40));
+    });
+    Check("GRID", [](StageCard& c, Array<Button>& t) {
+        c.SetStack(M::GRID);
+        for(int i = 0; i < t.GetCount(); ++i)
+            c.AddGrid(t[i], i % 5, i / 5);
+    });
+    Check("MASONRY", [](StageCard& c, Array<Button>& t) {
+        c.SetStackMasonry().MasonryCols(4);
+        for(int i = 0; i < t.GetCount(); ++i)
+            c.AddFixed(t[i], DPI(30) + DPI(10) * (i % 4));
+    });
+    RLOG("StageSteadyState: OK");
+}